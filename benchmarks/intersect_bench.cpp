@@ -0,0 +1,101 @@
+// Sorted doc_id intersection: every kernel against the automatic choice on
+// list pairs with Zipfian lengths, as AND queries see them. Term document
+// frequencies follow 1/rank over the vocabulary and query terms are drawn
+// with the same skew, so most pairs join a frequent term with a rarer one.
+// Results are grouped by the length ratio of the pair.
+//
+// Usage: intersect_bench [documents] [pairs]
+
+#include "Intersect.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr size_t kVocabulary = 50'000;
+
+struct Pair {
+    std::vector<uint32_t> a;
+    std::vector<uint32_t> b;
+};
+
+// About size doc_ids out of documents, spread by geometric gaps
+std::vector<uint32_t> RandomList(std::mt19937& rng, size_t size, size_t documents) {
+    double density = std::min(1.0, static_cast<double>(size) / documents);
+    std::geometric_distribution<uint32_t> gap(density);
+
+    std::vector<uint32_t> list;
+    list.reserve(size + size / 8);
+    uint64_t doc_id = gap(rng);
+    while (doc_id < documents) {
+        list.push_back(static_cast<uint32_t>(doc_id));
+        doc_id += 1 + gap(rng);
+    }
+    return list;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t documents = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5'000'000;
+    size_t pair_count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 400;
+
+    // Zipf(1) over term ranks: P(rank r) ~ 1/r
+    std::vector<double> weights(kVocabulary);
+    for (size_t r = 0; r < kVocabulary; ++r) weights[r] = 1.0 / static_cast<double>(r + 1);
+    std::discrete_distribution<size_t> term(weights.begin(), weights.end());
+    auto list_size = [&](size_t rank) {
+        return std::max<size_t>(1, documents / 2 / (rank + 1));
+    };
+
+    std::mt19937 rng(42);
+    const char* bucket_names[] = {"ratio < 4", "ratio < 32", "ratio < 256", "ratio >= 256"};
+    std::vector<Pair> buckets[4];
+    for (size_t p = 0; p < pair_count; ++p) {
+        Pair pair{RandomList(rng, list_size(term(rng)), documents), RandomList(rng, list_size(term(rng)), documents)};
+        if (pair.a.empty() || pair.b.empty()) continue;
+
+        size_t shorter = std::min(pair.a.size(), pair.b.size());
+        size_t longer = std::max(pair.a.size(), pair.b.size());
+        size_t bucket = longer < 4 * shorter ? 0 : longer < 32 * shorter ? 1 : longer < 256 * shorter ? 2 : 3;
+        buckets[bucket].push_back(std::move(pair));
+    }
+
+    std::vector<uint32_t> a_matches(documents);
+    std::vector<uint32_t> b_matches(documents);
+
+    std::printf("%zu documents, %zu pairs\n", documents, pair_count);
+    std::printf("%-14s %6s %12s %12s %12s %12s %12s\n",
+                "", "pairs", "merge", "gallop", "sse2", "avx2", "auto");
+    for (size_t bucket = 0; bucket < 4; ++bucket) {
+        if (buckets[bucket].empty()) continue;
+
+        std::printf("%-14s %6zu", bucket_names[bucket], buckets[bucket].size());
+        for (int kernel = 0; kernel <= 4; ++kernel) {
+            double best = 1e30;
+            uint64_t checksum = 0;
+            for (int round = 0; round < 5; ++round) {
+                auto start = std::chrono::steady_clock::now();
+                checksum = 0;
+                for (const Pair& pair : buckets[bucket]) {
+                    checksum += kernel == 4
+                        ? IntersectSorted(pair.a.data(), pair.a.size(), pair.b.data(), pair.b.size(),
+                                          a_matches.data(), b_matches.data())
+                        : IntersectSorted(static_cast<IntersectKernel>(kernel), pair.a.data(), pair.a.size(),
+                                          pair.b.data(), pair.b.size(), a_matches.data(), b_matches.data());
+                }
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                best = std::min(best, elapsed.count());
+            }
+            // Microseconds per pair; the checksum keeps the work alive.
+            std::printf(" %9.1f us%s", best * 1e6 / buckets[bucket].size(), checksum == 0 ? "*" : " ");
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+// Posting list decoding throughput and compression ratio: iterating a
+// compressed PostingList against a plain std::vector<Posting>, and the
+// StreamVByte decoder with and without SIMD.
+//
+// Usage: posting_codec_bench [postings] [density percent]
+
+#include "PostingCodec.h"
+#include "PostingList.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <vector>
+
+static double BestSeconds(const std::function<uint64_t()>& run, uint64_t& checksum) {
+    double best = 1e30;
+    for (int round = 0; round < 5; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        checksum = run();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4'000'000;
+    double density = (argc > 2 ? std::strtod(argv[2], nullptr) : 10.0) / 100.0;
+
+    std::mt19937 rng(42);
+    std::geometric_distribution<uint32_t> gap(density);
+    std::geometric_distribution<uint32_t> tf(0.6);
+
+    std::vector<Posting> postings;
+    postings.reserve(count);
+    uint32_t doc_id = 0;
+    for (size_t i = 0; i < count; ++i) {
+        doc_id += 1 + gap(rng);
+        postings.push_back({doc_id, 1 + tf(rng)});
+    }
+
+    PostingList list(postings);
+    std::printf("postings: %zu, raw %zu bytes, compressed %zu bytes (%.2f bytes/posting)\n",
+                count, count * sizeof(Posting), list.ByteSize(),
+                static_cast<double>(list.ByteSize()) / count);
+
+    uint64_t checksum = 0;
+    double seconds = BestSeconds([&] {
+        uint64_t sum = 0;
+        for (const Posting& posting : postings) sum += posting.doc_id + posting.tf;
+        return sum;
+    }, checksum);
+    std::printf("%-22s %8.1f M postings/s  (checksum %llu)\n", "std::vector<Posting>",
+                count / seconds / 1e6, static_cast<unsigned long long>(checksum));
+
+    seconds = BestSeconds([&] {
+        uint64_t sum = 0;
+        for (const Posting& posting : list) sum += posting.doc_id + posting.tf;
+        return sum;
+    }, checksum);
+    std::printf("%-22s %8.1f M postings/s  (checksum %llu)\n", "PostingList",
+                count / seconds / 1e6, static_cast<unsigned long long>(checksum));
+
+    // Raw gap decoding of one large StreamVByte stream
+    std::vector<uint32_t> gaps(count);
+    for (size_t i = 0; i < count; ++i) gaps[i] = postings[i].doc_id - (i ? postings[i - 1].doc_id : 0);
+    std::vector<uint8_t> encoded(StreamVByteMaxBytes(count));
+    encoded.resize(EncodeStreamVByte(gaps.data(), count, encoded.data()));
+    std::vector<uint32_t> decoded(count);
+
+    seconds = BestSeconds([&] {
+        DecodeStreamVByteDeltasScalar(encoded.data(), encoded.data() + encoded.size(), count, 0, decoded.data());
+        return static_cast<uint64_t>(decoded.back());
+    }, checksum);
+    std::printf("%-22s %8.1f M ints/s\n", "StreamVByte scalar", count / seconds / 1e6);
+
+    seconds = BestSeconds([&] {
+        DecodeStreamVByteDeltas(encoded.data(), encoded.data() + encoded.size(), count, 0, decoded.data());
+        return static_cast<uint64_t>(decoded.back());
+    }, checksum);
+    std::printf("%-22s %8.1f M ints/s\n", "StreamVByte dispatched", count / seconds / 1e6);
+    return 0;
+}
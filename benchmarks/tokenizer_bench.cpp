@@ -0,0 +1,88 @@
+// Tokenization throughput: std::istringstream >> std::string (what the
+// indexer used to do) against Tokenizer on every kernel the CPU supports.
+//
+// Usage: tokenizer_bench [megabytes]
+
+#include "TextKernel.h"
+#include "Tokenizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static std::string MakeCorpus(size_t bytes) {
+    static const char* words[] = {
+        "the", "of", "and", "Moscow", "capital", "Russia", "search", "engine",
+        "inverted", "index", "posting", "QUERY", "document", "2024", "milk",
+        "water", "\xd0\xbc\xd0\xbe\xd1\x81\xd0\xba\xd0\xb2\xd0\xb0", "americano",
+    };
+    static const char* separators[] = {" ", " ", " ", ", ", ". ", "\n", " - ", "; "};
+
+    std::mt19937 rng(42);
+    // Roughly Zipfian word choice.
+    std::discrete_distribution<size_t> pick_word({
+        30, 15, 10, 8, 6, 5, 4, 4, 3, 3, 2, 2, 2, 1, 1, 1, 1, 1});
+    std::uniform_int_distribution<size_t> pick_separator(0, std::size(separators) - 1);
+
+    std::string corpus;
+    corpus.reserve(bytes + 64);
+    while (corpus.size() < bytes) {
+        corpus += words[pick_word(rng)];
+        corpus += separators[pick_separator(rng)];
+    }
+    return corpus;
+}
+
+static double BestSeconds(const std::function<size_t()>& run, size_t& tokens) {
+    double best = 1e30;
+    for (int round = 0; round < 5; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        tokens = run();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+static void Report(const char* name, size_t bytes, double seconds, size_t tokens) {
+    std::printf("%-16s %8.3f GB/s  %10zu tokens\n", name, bytes / seconds / 1e9, tokens);
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    std::string corpus = MakeCorpus(megabytes * 1024 * 1024);
+
+    std::printf("corpus: %zu bytes, detected kernel: %s\n",
+                corpus.size(), TextKernelIsaName(DetectTextKernelIsa()));
+
+    size_t tokens = 0;
+    double seconds = BestSeconds([&] {
+        std::istringstream stream(corpus);
+        std::string word;
+        size_t count = 0;
+        while (stream >> word) ++count;
+        return count;
+    }, tokens);
+    Report("istream >>", corpus.size(), seconds, tokens);
+
+    for (auto isa : {TextKernelIsa::Scalar, TextKernelIsa::SSE2, TextKernelIsa::AVX2}) {
+        if (isa > DetectTextKernelIsa()) continue;
+
+        seconds = BestSeconds([&] {
+            Tokenizer tokenizer(corpus, isa);
+            std::string_view word;
+            size_t count = 0;
+            while (tokenizer.Next(word)) ++count;
+            return count;
+        }, tokens);
+        Report((std::string("Tokenizer/") + TextKernelIsaName(isa)).c_str(),
+               corpus.size(), seconds, tokens);
+    }
+    return 0;
+}
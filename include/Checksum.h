@@ -0,0 +1,12 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli). Uses the SSE4.2 crc32 instruction when the CPU has
+// it. Pass the previous result as crc to checksum data in pieces; start
+// with 0.
+uint32_t Crc32c(uint32_t crc, const void* data, size_t size);
+
+#endif // CHECKSUM_H
@@ -2,6 +2,7 @@
 #define CONVERTERJSON_H
 
 #include <nlohmann/json.hpp>
+#include <filesystem>
 #include <string>
 #include <vector>
 #include <utility>
@@ -12,6 +13,33 @@ public:
 
     std::vector<std::string> GetRequests() const;
 
+    // "max_responses" of the config section: the most results returned per
+    // request. Throws std::runtime_error unless it is a positive integer.
+    int GetResponsesLimit() const;
+
+    // Optional "index_file" of the config section; empty if not set
+    std::string GetIndexFile() const;
+
+    // Optional "index_memory_mb" of the config section in bytes; 0 if not
+    // set, i.e. indexing keeps everything in memory
+    size_t GetIndexMemoryBudget() const;
+
+    // Optional "index_spill_dir" of the config section: where indexing
+    // spills runs and merges write segments; empty if not set, i.e. the
+    // system temp directory
+    std::string GetIndexSpillDirectory() const;
+
+    // Optional "result_cache_mb" of the config section in bytes; 0 if not
+    // set, i.e. search results are not cached
+    size_t GetResultCacheBudget() const;
+
+    // Optional "posting_cache_mb" of the config section in bytes; 0 if not
+    // set, i.e. posting lists are decoded on every read
+    size_t GetPostingCacheBudget() const;
+
+    // Optional "index_positions" of the config section; false if not set
+    bool GetIndexPositions() const;
+
     void putAnswers(const std::vector<std::vector<std::pair<int, float>>>& answers) const;
 
 private:
@@ -20,10 +48,14 @@ private:
     mutable json config_cache;
     mutable json requests_cache;
     mutable bool config_loaded = false;
+    mutable std::filesystem::file_time_type config_mtime;
     mutable bool requests_loaded = false;
 
     void loadConfig() const;
     void loadRequests() const;
+    // Optional size in megabytes from the config section, in bytes; 0 if
+    // not set. Throws std::runtime_error if negative.
+    size_t getMegabytes(const std::string& field) const;
     json safeParse(const std::string& filename) const;
 };
 
@@ -0,0 +1,109 @@
+#ifndef EXTERNALSORT_H
+#define EXTERNALSORT_H
+
+#include "PostingList.h"
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Spill files of an external-sort index build. A run holds (term, doc_id,
+// tf) triples sorted by term and doc_id, stored grouped by term; each
+// posting is followed by its token positions, if the run has any:
+//
+//   per term: uint32 term size, term bytes, uint32 posting count,
+//             uint32 position count,
+//             count x { uint32 doc_id, uint32 tf, [tf x uint32 position] }
+class RunWriter {
+public:
+    explicit RunWriter(const std::string& path);
+
+    // Terms must be added in ascending byte order, postings in doc_id order.
+    // positions is laid out as for PositionList, or empty.
+    void Add(std::string_view term, const std::vector<Posting>& postings,
+             const std::vector<uint32_t>& positions = {});
+
+    // Flushes the run; throws std::runtime_error if writing failed.
+    void Finish();
+
+private:
+    std::string path;
+    std::ofstream out;
+};
+
+// Reads a run one posting at a time, so a term never has to fit into
+// memory.
+class RunReader {
+public:
+    explicit RunReader(const std::string& path);
+
+    // Moves to the next term, skipping what is left of the current one;
+    // false at the end of the run.
+    bool Next();
+    const std::string& Term() const { return term; }
+
+    // Moves to the next posting of the current term; false after the last.
+    bool NextPosting();
+    const Posting& Current() const { return current; }
+    // Positions of the current posting; empty if the run has none
+    const std::vector<uint32_t>& Positions() const { return positions; }
+
+private:
+    std::string path;
+    std::ifstream in;
+    std::string term;
+    size_t postings_left = 0;
+    bool has_positions = false;
+    Posting current{};
+    std::vector<uint32_t> positions;
+};
+
+// K-way merge of runs. Terms and the postings of each term are both
+// streamed, so it holds one posting per run in memory, however common the
+// term.
+class RunMerger {
+public:
+    explicit RunMerger(const std::vector<std::string>& paths);
+
+    // Moves to the next term of all runs; false once they are exhausted.
+    bool NextTerm();
+    const std::string& Term() const { return term; }
+
+    // Next posting of the current term from any run, in doc_id order, and
+    // its positions; false once the term is done. A document must not be
+    // in two runs under the same term.
+    bool NextPosting(Posting& posting, std::vector<uint32_t>& positions);
+
+private:
+    std::vector<std::unique_ptr<RunReader>> readers;
+    // Min-heap of reader indexes by current term
+    std::vector<size_t> heap;
+    // Readers with postings of the current term left, a min-heap by the
+    // doc_id of their current posting
+    std::vector<size_t> term_readers;
+    // Readers done with the current term
+    std::vector<size_t> finished;
+    std::string term;
+};
+
+// Uniquely named directory under parent, created if missing, or under the
+// system temp directory if parent is empty. Removed with everything in it
+// on destruction.
+class TempDirectory {
+public:
+    explicit TempDirectory(const std::string& parent = std::string());
+    ~TempDirectory();
+
+    TempDirectory(const TempDirectory&) = delete;
+    TempDirectory& operator=(const TempDirectory&) = delete;
+
+    std::string File(const std::string& name) const;
+
+private:
+    std::string path;
+};
+
+#endif // EXTERNALSORT_H
@@ -0,0 +1,42 @@
+#ifndef INTERSECT_H
+#define INTERSECT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Intersection of two strictly increasing uint32 arrays, such as doc_id
+// lists. The result is reported as positions in both inputs, so callers can
+// pick up per-document data (term frequencies, ranks) on either side.
+//
+// Merge: scalar two-pointer merge.
+// Gallop: every value of the shorter array is searched for in the longer
+// one by exponential then binary search; cost grows with the shorter
+// length times the log of the gap, which wins on skewed pairs.
+// SSE2, AVX2: block merge comparing 4 (8) values of each array against
+// each other with shuffles; the block with the smaller maximum moves on.
+enum class IntersectKernel {
+    Merge,
+    Gallop,
+    SSE2,
+    AVX2
+};
+
+// Kernel for arrays of these lengths: galloping once one array is much
+// longer than the other, otherwise the best block merge the CPU supports.
+IntersectKernel ChooseIntersectKernel(size_t a_size, size_t b_size);
+
+const char* IntersectKernelName(IntersectKernel kernel);
+
+// Writes the positions of the values common to a[0, a_size) and
+// b[0, b_size): the i-th common value is a[a_matches[i]] == b[b_matches[i]],
+// in increasing order. Both outputs must hold min(a_size, b_size) entries.
+// Returns the number of common values.
+size_t IntersectSorted(const uint32_t* a, size_t a_size, const uint32_t* b, size_t b_size,
+                       uint32_t* a_matches, uint32_t* b_matches);
+
+// Same, with an explicit kernel. A kernel the CPU does not support falls
+// back to the best supported one.
+size_t IntersectSorted(IntersectKernel kernel, const uint32_t* a, size_t a_size,
+                       const uint32_t* b, size_t b_size, uint32_t* a_matches, uint32_t* b_matches);
+
+#endif // INTERSECT_H
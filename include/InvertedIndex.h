@@ -2,24 +2,245 @@
 #define INVERTEDINDEX_H
 
 #include "ConverterJSON.h"
+#include "ExternalSort.h"
+#include "MergePolicy.h"
+#include "PositionList.h"
+#include "PostingCache.h"
+#include "PostingList.h"
+#include "Segment.h"
+#include "ShardedLru.h"
+#include "ThreadPool.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
 #include <unordered_map>
 #include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
+// Log-structured index: every update writes the documents it (re)indexed
+// into a new immutable segment and marks their previous versions deleted
+// in the older segments. A tiered merge policy compacts segments in the
+// background, dropping deleted postings on the way.
 class InvertedIndex {
 public:
-    InvertedIndex() = default;
+    // A segment as seen by queries: immutable postings plus the documents
+    // deleted from it so far.
+    struct LiveSegment {
+        std::shared_ptr<const Segment> segment;
+        // Indexed by doc_id; copied on write, never modified once shared
+        std::shared_ptr<const std::vector<bool>> deleted;
+        size_t deleted_count = 0;
 
+        bool IsDeleted(uint32_t doc_id) const {
+            return doc_id < deleted->size() && (*deleted)[doc_id];
+        }
+    };
+
+    // Immutable view of the whole index. Updates and merges publish a new
+    // snapshot atomically; holders of an older one keep a consistent view
+    // of the index as it was, for as long as they hold it.
+    struct Snapshot {
+        std::vector<LiveSegment> segments;
+        // Generation the snapshot belongs to
+        uint64_t generation = 0;
+
+        Snapshot();
+
+        // Whether any segment has the word in its dictionary. Words found
+        // in none are remembered for the life of the snapshot, so repeated
+        // misses, e.g. misspelt query words, skip the segments altogether.
+        bool HasTerm(const std::string& word) const;
+
+    private:
+        mutable ShardedLru<std::string, bool> absent_terms;
+    };
+
+    // thread_count == 0 sizes the indexing pool to hardware_concurrency
+    explicit InvertedIndex(size_t thread_count = 0,
+                           const TieredMergePolicy::Options& merge_options = TieredMergePolicy::Options());
+    ~InvertedIndex();
+
+    // Brings the index in line with the documents listed in config.json.
+    // Only added, removed or modified documents are (re)processed; a new
+    // generation starts if anything changed.
     void UpdateDocumentBase();
 
-    const std::unordered_map<size_t, size_t>& GetWordCount(const std::string& word) const;
+    // Removes a document from the index right away: its postings are only
+    // marked deleted and skipped by queries, and purged by a later merge.
+    // It stays deleted until its file changes or UpdateDocument is called.
+    // Returns false if there was no live version of the document.
+    bool DeleteDocument(size_t doc_id);
+
+    // Reindexes one document from path right away, replacing the current
+    // version; doc_id may extend the document list. A missing file deletes
+    // the document. UpdateDocumentBase goes back to the path in config.json.
+    void UpdateDocument(size_t doc_id, const std::string& path);
+
+    // Writes the index to a segment file at path, merging all segments.
+    // Deleted documents are recorded as such and stay deleted after Load.
+    void Save(const std::string& path) const;
+
+    // Replaces the index with the segment file at path. Postings stay in
+    // the mapped file and are only paged in as they are read; documents
+    // changed since the save are picked up by the next update. With
+    // verify_checksum set the whole file is read once to check its CRC.
+    // Throws std::runtime_error if the file is missing or malformed;
+    // lookups throw it for corrupt postings the checks on open missed.
+    void Load(const std::string& path, bool verify_checksum = false);
+
+    // Rebuilds the index only if it was never built or the corpus changed
+    // since the last build. Returns true if a rebuild happened.
+    bool Refresh();
+
+    // True if the file list or any indexed document changed on disk.
+    bool IsStale() const;
+
+    // Incremented by every update that changed the index; 0 means the index
+    // was never built. Merges do not change the contents.
+    uint64_t Generation() const { return generation.load(); }
+
+    // Current snapshot. Never blocks, not even during an update; queries
+    // should take one and evaluate entirely against it.
+    std::shared_ptr<const Snapshot> GetSnapshot() const;
+
+    // Blocks until no merge is running or pending.
+    void WaitForMerges();
+
+    // Live postings of word across all segments, sorted by doc_id
+    PostingList GetWordCount(const std::string& word) const;
+
+    // Postings of a term of one segment, including deleted documents.
+    // Terms read often come decoded from the posting cache, sized by
+    // "posting_cache_mb" in config.json as of the last update.
+    PostingList TermPostings(const LiveSegment& segment, uint32_t term_id) const;
+    PostingCache::Stats PostingCacheStats() const { return posting_cache.GetStats(); }
 private:
-    void ProcessFile(const std::string& files_path, const size_t doc_id);
+    // Postings of a term collected while indexing, in doc_id order; with
+    // positions indexed also their token positions, laid out as for
+    // PositionList
+    struct Postings {
+        std::vector<Posting> postings;
+        std::vector<uint32_t> positions;
+    };
+    using Dictionary = std::unordered_map<std::string, Postings>;
+    // A dictionary split into partitions by term hash
+    using PartitionedDictionary = std::vector<Dictionary>;
+
+    // A term of a segment being built, with its lists encoded
+    struct EncodedTerm {
+        std::string term;
+        PostingList postings;
+        PositionList positions;
+    };
+
+    // Fingerprint of a document as it was indexed
+    struct DocumentInfo {
+        std::string path;
+        bool exists = false;
+        // Removed by DeleteDocument and not reindexed since
+        bool deleted = false;
+        // Not a regular file (e.g. a FIFO): always treated as changed
+        bool special = false;
+        uintmax_t size = 0;
+        std::filesystem::file_time_type mtime;
+        uint64_t content_hash = 0;
+
+        static DocumentInfo Read(const std::string& path);
+        // Cheap check on path, size and mtime only
+        bool SameFileState(const DocumentInfo& other) const;
+    };
+
+    // Filled by one batch without synchronization: postings to add,
+    // partitioned by term hash; documents whose previous version is gone;
+    // documents that got new postings. Under a memory budget the postings
+    // are spilled to sorted runs whenever bytes exceeds the batch's share.
+    struct LocalIndex {
+        PartitionedDictionary dictionary;
+        // Whether token positions are recorded
+        bool positions;
+        std::vector<uint32_t> changed;
+        std::vector<uint32_t> processed;
+        // Approximate memory held by dictionary
+        size_t bytes = 0;
+        std::vector<std::string> runs;
+
+        LocalIndex(size_t partitions, bool positions) : dictionary(partitions), positions(positions) {}
+    };
 
-    std::unordered_map<std::string, std::unordered_map<size_t, size_t>> freq_dictionary;
-    std::mutex dict_mutex;
+    // Applies an update under dict_mutex; returns true if the index changed.
+    bool ApplyUpdate();
+    // Re-reads one document; returns false if its postings stay the same.
+    bool RereadDocument(const std::string& files_path, const size_t doc_id, LocalIndex& local_index);
+    void ProcessFile(std::string_view content, const size_t doc_id, LocalIndex& local_index) const;
+    // Builds a segment from the postings of the local indexes, in memory;
+    // or, if they were spilled, by streaming their runs posting by posting
+    // into a mapped file in spill_dir.
+    std::shared_ptr<const Segment> BuildSegment(std::vector<LocalIndex>& local_indexes,
+                                                const TempDirectory* spill_dir, bool positions);
+    // Writes the postings of local_index to a new run and drops them
+    void SpillRun(LocalIndex& local_index, const std::string& path) const;
+    void AddDocuments(const std::vector<LocalIndex>& local_indexes, SegmentWriter& writer) const;
+    // Merges one hash partition of all local indexes, emptying it there,
+    // and encodes its terms into encoded
+    void MergePartition(size_t partition, std::vector<LocalIndex>& local_indexes,
+                        std::vector<EncodedTerm>& encoded);
+    // Marks the live version of each document deleted in the segment
+    // holding it; returns the updated segment list. deleted, if given, is
+    // set to the number of live versions found.
+    std::vector<LiveSegment> DeleteDocuments(const std::vector<uint32_t>& doc_ids, size_t* deleted = nullptr) const;
+    // Publishes a new snapshot with the given segments, dropping those
+    // without live documents. Starts a new generation unless the contents
+    // stay the same, as with merges.
+    void Publish(std::vector<LiveSegment> updated, bool new_generation);
+
+    // Whether a merge of segments keeps positions: only if all have them
+    static bool HavePositions(const std::vector<LiveSegment>& segments);
+    // Writes the live postings of inputs to writer, which must have
+    // positions if HavePositions(inputs). pace is called with
+    // the bytes written after every term; the merge is abandoned, returning
+    // false, as soon as it returns false.
+    static bool MergeSegments(const std::vector<LiveSegment>& inputs, SegmentWriter& writer,
+                              const std::function<bool(size_t)>& pace);
+    // Runs one merge picked by the merge policy, writing the merged segment
+    // to a mapped file under the spill directory; false if there was none.
+    bool MergeOnce();
+    void ScheduleMerges();
+    void MergeLoop();
+
+    ThreadPool& Pool();
+
+    // Only accessed through std::atomic_load / std::atomic_store
+    std::shared_ptr<const Snapshot> snapshot = std::make_shared<Snapshot>();
+    std::vector<DocumentInfo> documents;
+    std::atomic<uint64_t> generation{0};
+    // Serializes updates, loads and merge commits; readers never take it
+    mutable std::mutex dict_mutex;
     ConverterJSON converter;
+
+    size_t thread_count;
+    std::unique_ptr<ThreadPool> pool;
+
+    mutable PostingCache posting_cache;
+
+    TieredMergePolicy merge_policy;
+    std::thread merge_thread;
+    std::mutex merge_mutex;
+    // "index_spill_dir" as of the last update, for merges; guarded by
+    // merge_mutex
+    std::string spill_directory;
+    std::condition_variable merge_cv;
+    std::condition_variable merge_idle_cv;
+    bool merge_requested = false;
+    bool merging = false;
+    std::atomic<bool> stopping{false};
 };
 
 #endif // INVERTEDINDEX_H
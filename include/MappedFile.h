@@ -0,0 +1,39 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <string_view>
+
+// Read-only view of a whole file. Regular files are memory-mapped; pipes,
+// character devices and other special files are read into a buffer.
+class MappedFile {
+public:
+    // Paging hint for mapped files
+    enum class Access { Sequential, Random };
+
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path, Access access = Access::Sequential);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool IsOpen() const { return is_open; }
+    bool IsMapped() const { return mapping != nullptr; }
+
+    std::string_view Data() const;
+
+private:
+    bool Map(int fd, size_t size, Access access);
+    bool ReadAll(int fd);
+    void Release();
+
+    bool is_open = false;
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+    std::string buffer;
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,65 @@
+#ifndef MERGEPOLICY_H
+#define MERGEPOLICY_H
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+// Picks segments to merge so that the number of segments stays logarithmic
+// in the index size. Segments are grouped into tiers by live size, each tier
+// segments_per_tier times larger than the one below; once a tier holds
+// segments_per_tier segments, they are merged into one of the next tier.
+// A segment whose deleted fraction exceeds max_deleted_fraction is rewritten
+// on its own to purge the dead postings.
+class TieredMergePolicy {
+public:
+    struct Options {
+        size_t segments_per_tier = 10;
+        // Segments smaller than this all count as the lowest tier
+        size_t floor_segment_bytes = 2 << 20;
+        double max_deleted_fraction = 0.25;
+        // Upper bound on merge output; 0 disables throttling
+        double max_merge_bytes_per_second = 64.0 * (1 << 20);
+        // Merge on a background thread instead of at the end of each update
+        bool background = true;
+    };
+
+    TieredMergePolicy() = default;
+    explicit TieredMergePolicy(const Options& options) : options(options) {}
+
+    const Options& GetOptions() const { return options; }
+
+    struct SegmentInfo {
+        size_t live_bytes;
+        size_t documents;
+        size_t deleted;
+    };
+
+    // Indexes into segments of the segments to merge next; empty if there
+    // is nothing to do. Full tiers go first, lower ones before higher ones
+    // as they are cheaper to merge; then the segment with the most
+    // deletions past the threshold.
+    std::vector<size_t> FindMerge(const std::vector<SegmentInfo>& segments) const;
+
+private:
+    size_t TierOf(size_t bytes) const;
+
+    Options options;
+};
+
+// Spreads merge output over time so merges do not starve queries of CPU
+// and I/O.
+class MergeRateLimiter {
+public:
+    explicit MergeRateLimiter(double bytes_per_second);
+
+    // How long to pause after another bytes of output
+    std::chrono::steady_clock::duration Account(size_t bytes);
+
+private:
+    double bytes_per_second;
+    double written = 0;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif // MERGEPOLICY_H
@@ -0,0 +1,91 @@
+#ifndef POSITIONLIST_H
+#define POSITIONLIST_H
+
+#include "PostingList.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Token positions of every posting of one term, aligned with the blocks of
+// its PostingList. A posting with term frequency tf has tf positions:
+//
+//   uint32 block_count
+//   block_count x uint32 offset
+//   per block, per posting: varint byte size, StreamVByte position gaps
+//
+// The byte size prefix lets a lookup hop over the other postings of the
+// block without decoding them, so positions are only ever decoded for the
+// postings that are actually looked at.
+//
+// Like PostingList, a list owns its bytes or is a view into a segment.
+class PositionList {
+public:
+    PositionList() = default;
+    // positions holds the positions of each posting back to back, sorted
+    // per posting; posting i contributes postings[i].tf of them.
+    PositionList(const std::vector<Posting>& postings, const std::vector<uint32_t>& positions);
+
+    // Non-owning view over an encoded list; bytes must outlive the view
+    static PositionList View(const uint8_t* bytes, size_t size);
+
+    PositionList(const PositionList& other);
+    PositionList& operator=(const PositionList& other);
+    PositionList(PositionList&& other) noexcept;
+    PositionList& operator=(PositionList&& other) noexcept;
+
+    bool empty() const { return byte_size == 0; }
+
+    // Positions of the index-th posting, whose term frequency is tf
+    void Decode(size_t index, uint32_t tf, std::vector<uint32_t>& out) const;
+    // Appends the positions of all postings of a block; tfs holds the
+    // block's term frequencies as decoded by PostingList::DecodeBlock.
+    // Both throw std::runtime_error if a posting runs past the list's bytes.
+    void DecodeBlock(size_t block, const uint32_t* tfs, size_t count, std::vector<uint32_t>& out) const;
+
+    // Checks the header against the byte size and the block count of the
+    // postings, for views of untrusted bytes.
+    bool VerifyHeaders(size_t block_count) const;
+
+    const uint8_t* Bytes() const { return bytes; }
+    size_t ByteSize() const { return byte_size; }
+
+private:
+    const uint8_t* BlockBegin(size_t block) const;
+
+    const uint8_t* bytes = nullptr;
+    size_t byte_size = 0;
+    std::vector<uint8_t> owned;
+};
+
+// Encodes a PositionList posting by posting, the counterpart of
+// PostingListEncoder: payload goes to write as it is produced, the header
+// with the block offsets is returned by Finish.
+class PositionListEncoder {
+public:
+    using Write = PostingListEncoder::Write;
+
+    explicit PositionListEncoder(Write write) : write(std::move(write)) {}
+
+    // Positions of the next posting, tf of them in ascending order
+    void Add(const uint32_t* positions, uint32_t tf);
+
+    // Returns the bytes that go before the payload.
+    std::vector<uint8_t> Finish();
+
+private:
+    Write write;
+    size_t count = 0;
+    size_t payload_size = 0;
+    // Relative to the payload
+    std::vector<uint32_t> block_offsets;
+    std::vector<uint32_t> gaps;
+    std::vector<uint8_t> encoded;
+};
+
+// Sorts postings by doc_id and moves their positions (laid out as for
+// PositionList, possibly empty) along with them.
+void SortByDocId(std::vector<Posting>& postings, std::vector<uint32_t>& positions);
+
+#endif // POSITIONLIST_H
@@ -0,0 +1,72 @@
+#ifndef POSTINGCACHE_H
+#define POSTINGCACHE_H
+
+#include "PostingList.h"
+#include "Segment.h"
+#include "ShardedLru.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+// Decoded posting lists of frequently read terms, kept in memory so that
+// hot queries neither decode them again nor fault in pages of a mapped
+// segment that the OS has dropped under memory pressure.
+//
+// A term is only admitted on its second read since the last reset of a
+// small per-shard filter, so one-off terms are served straight from the
+// segment and never push hot ones out. Entries are keyed by segment and
+// term id and hold a weak reference to their segment: lists of segments
+// that merges dropped are never returned and age out of the LRU order.
+class PostingCache {
+public:
+    struct Key {
+        const Segment* segment;
+        uint32_t term_id;
+
+        bool operator==(const Key& other) const {
+            return segment == other.segment && term_id == other.term_id;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Cached {
+        std::weak_ptr<const Segment> segment;
+        PostingList postings;
+    };
+    using Stats = ShardedLru<Key, Cached, KeyHash>::Stats;
+
+    // capacity_bytes == 0 disables the cache.
+    explicit PostingCache(size_t capacity_bytes = 0, size_t shard_count = 16);
+
+    // Changes the memory cap, evicting entries over the new one
+    void SetCapacity(size_t capacity_bytes);
+    bool Enabled() const { return lru.Enabled(); }
+
+    // Postings of term_id in segment: the cached decoded list, or a view
+    // into the segment for terms that are not hot (yet).
+    PostingList Postings(const std::shared_ptr<const Segment>& segment, uint32_t term_id);
+
+    Stats GetStats() const { return lru.GetStats(); }
+
+private:
+    // Keys read once since the last reset, split like the LRU
+    struct SeenShard {
+        std::mutex mutex;
+        std::unordered_set<Key, KeyHash> keys;
+    };
+
+    // Records a read of key; true if it was read once before since the
+    // last reset of its shard
+    bool ReadBefore(const Key& key);
+
+    ShardedLru<Key, Cached, KeyHash> lru;
+    std::vector<std::unique_ptr<SeenShard>> seen;
+};
+
+#endif // POSTINGCACHE_H
@@ -0,0 +1,45 @@
+#ifndef POSTINGCODEC_H
+#define POSTINGCODEC_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Integer codecs for posting blocks.
+//
+// StreamVByte: one control byte per group of four values (2 bits each: the
+// value's byte length - 1), followed by the values' significant bytes. The
+// decoder expands four values per control byte with a single byte shuffle
+// when SSSE3 is available.
+//
+// Bit packing: count values of width bits each in a little-endian bit
+// stream.
+
+// Upper bound of EncodeStreamVByte's output for count values
+size_t StreamVByteMaxBytes(size_t count);
+
+// Encodes values[0, count) into out; returns the number of bytes written.
+size_t EncodeStreamVByte(const uint32_t* values, size_t count, uint8_t* out);
+
+// Decodes count values encoded by EncodeStreamVByte from in and turns them
+// from gaps into a running sum starting after base: out[i] = base + in[0] +
+// ... + in[i]. Never reads at or past limit. Returns the end of the input,
+// or nullptr if the input ends before count values.
+const uint8_t* DecodeStreamVByteDeltas(const uint8_t* in, const uint8_t* limit, size_t count,
+                                       uint32_t base, uint32_t* out);
+
+// Same, without SIMD; for tests and benchmarks.
+const uint8_t* DecodeStreamVByteDeltasScalar(const uint8_t* in, const uint8_t* limit, size_t count,
+                                             uint32_t base, uint32_t* out);
+
+// Bits needed to store value
+unsigned BitWidth(uint32_t value);
+
+size_t BitPackedBytes(size_t count, unsigned width);
+
+// Packs values[0, count) into out using width bits each; returns the bytes
+// written. Values must fit into width bits.
+size_t BitPack(const uint32_t* values, size_t count, unsigned width, uint8_t* out);
+
+void BitUnpack(const uint8_t* in, size_t count, unsigned width, uint32_t* out);
+
+#endif // POSTINGCODEC_H
@@ -0,0 +1,192 @@
+#ifndef POSTINGLIST_H
+#define POSTINGLIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+struct Posting {
+    uint32_t doc_id;
+    uint32_t tf;
+
+    bool operator==(const Posting& other) const {
+        return doc_id == other.doc_id && tf == other.tf;
+    }
+};
+
+// Postings of one term sorted by doc_id, stored compressed in blocks of
+// kBlockSize documents:
+//
+//   uint32 count, uint32 block_count, uint32 max_tf
+//   block_count x { uint32 last_doc_id, uint32 offset, uint32 max_tf }
+//   per block: uint8 tf_width, StreamVByte doc_id gaps, bit-packed tf - 1
+//
+// Gaps restart at every block (relative to the previous block's last
+// doc_id), so any block can be decoded on its own. Iteration decodes one
+// block at a time. The block headers double as skip pointers: last_doc_id
+// tells whether a block can hold a document without decoding it, offset
+// locates its payload. The max_tf fields bound the score of any posting of
+// the list or block without decoding it, for dynamic pruning.
+//
+// A list either owns its encoded bytes or is a view into memory owned by
+// someone else, e.g. a memory-mapped index segment. A decoded list (see
+// Decoded) also keeps every block decoded, shared between its copies.
+class PostingList {
+public:
+    static constexpr size_t kBlockSize = 128;
+    // doc_id of the posting at end(), above every real doc_id
+    static constexpr uint32_t kEndDocId = UINT32_MAX;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Posting;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Posting*;
+        using reference = const Posting&;
+
+        const_iterator() = default;
+
+        reference operator*() const { return current; }
+        pointer operator->() const { return &current; }
+        const_iterator& operator++();
+
+        // Moves to the first posting with doc_id >= target, or to end();
+        // never moves back. Blocks in between are skipped by their headers
+        // without being decoded.
+        void Advance(uint32_t target);
+
+        // Block of the current posting, BlockCount() at end()
+        size_t Block() const { return block; }
+        // Position of the current posting in the list
+        size_t Index() const { return block * kBlockSize + index; }
+
+        bool operator==(const const_iterator& other) const {
+            return block == other.block && index == other.index;
+        }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class PostingList;
+        const_iterator(const PostingList* list, size_t block);
+        void Load();
+
+        const PostingList* list = nullptr;
+        size_t block = 0;
+        size_t index = 0;
+        size_t block_size = 0;
+        Posting current{};
+        uint32_t doc_ids[kBlockSize];
+        uint32_t tfs[kBlockSize];
+    };
+
+    PostingList() = default;
+    // postings must be sorted by doc_id
+    explicit PostingList(const std::vector<Posting>& postings);
+
+    // Non-owning view over an encoded list; bytes must outlive the view
+    static PostingList View(const uint8_t* bytes, size_t size);
+
+    PostingList(const PostingList& other);
+    PostingList& operator=(const PostingList& other);
+    PostingList(PostingList&& other) noexcept;
+    PostingList& operator=(PostingList&& other) noexcept;
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, BlockCount()); }
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+
+    // Term frequency in doc_id; throws std::out_of_range if the term does
+    // not occur in that document.
+    size_t at(size_t doc_id) const;
+
+    std::vector<Posting> Decode() const;
+
+    // Copy holding its own bytes and all of its blocks decoded, for lists
+    // read over and over: DecodeBlock then only copies values out. Copies
+    // of the result share that memory.
+    PostingList Decoded() const;
+    bool IsDecoded() const { return decoded != nullptr; }
+    // Heap memory held by the list, compressed and decoded
+    size_t MemoryBytes() const;
+
+    // Largest term frequency in the list; 0 if empty
+    uint32_t MaxTf() const;
+
+    size_t BlockCount() const;
+    size_t BlockSize(size_t block) const;
+    uint32_t BlockLastDocId(size_t block) const;
+    uint32_t BlockMaxTf(size_t block) const;
+    // First block from `from` on whose last doc_id is not below doc_id,
+    // i.e. the only one that can hold it; BlockCount() if there is none.
+    // The search gallops forward from `from`.
+    size_t FindBlock(uint32_t doc_id, size_t from = 0) const;
+    // Decodes one block into doc_ids and tfs, each holding kBlockSize values.
+    // Throws std::runtime_error if the block runs past the list's bytes.
+    void DecodeBlock(size_t block, uint32_t* doc_ids, uint32_t* tfs) const;
+
+    // Checks the list and block headers against the byte size, for views of
+    // untrusted bytes: DecodeBlock relies on them and checks the rest.
+    bool VerifyHeaders() const;
+
+    // The compressed representation
+    const uint8_t* Bytes() const { return bytes; }
+    size_t ByteSize() const { return byte_size; }
+    bool IsView() const { return bytes != nullptr && owned.empty() && !decoded; }
+
+    bool operator==(const PostingList& other) const;
+
+private:
+    struct DecodedBlocks {
+        std::vector<uint8_t> bytes;
+        std::vector<uint32_t> doc_ids;
+        std::vector<uint32_t> tfs;
+    };
+
+    uint32_t ReadHeader(size_t offset) const;
+
+    // Either owned.data(), decoded->bytes.data() or external memory
+    const uint8_t* bytes = nullptr;
+    size_t byte_size = 0;
+    std::vector<uint8_t> owned;
+    std::shared_ptr<const DecodedBlocks> decoded;
+};
+
+// Encodes a PostingList a block at a time, for lists too long to be held
+// decoded. The payload of every block goes to write as soon as the block
+// is full; the list and block headers, which precede the payload in the
+// encoding, are only known at the end and returned by Finish.
+class PostingListEncoder {
+public:
+    using Write = std::function<void(const uint8_t*, size_t)>;
+
+    explicit PostingListEncoder(Write write) : write(std::move(write)) {}
+
+    // Postings must be added in ascending doc_id order.
+    void Add(const Posting& posting);
+    size_t size() const { return count; }
+
+    // Writes the last block; returns the bytes that go before the payload.
+    std::vector<uint8_t> Finish();
+
+private:
+    void EncodeBlock();
+
+    Write write;
+    uint32_t gaps[PostingList::kBlockSize];
+    uint32_t tfs[PostingList::kBlockSize];
+    size_t pending = 0;
+    size_t count = 0;
+    uint32_t previous = 0;
+    uint32_t max_tf = 0;
+    size_t payload_size = 0;
+    // Block headers with payload offsets relative to the payload
+    std::vector<uint32_t> block_headers;
+    std::vector<uint8_t> encoded;
+};
+
+#endif // POSTINGLIST_H
@@ -0,0 +1,57 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A search request parsed into an operator tree.
+//
+//   a b          documents containing a or b; OR may be spelled out
+//   a AND b      documents containing both
+//   a NOT b      documents containing a but not b; NOT binds to the
+//                operand before it, a lone NOT matches nothing
+//   ( ... )      grouping
+//   "a b"        a phrase: the words at consecutive positions
+//   a NEAR/k b   a and b within k positions, in any order; a chain
+//                a NEAR/k b NEAR/m c needs all words within the largest
+//                distance. NEAR only binds plain words.
+//
+// AND binds tighter than OR. Operators are case-sensitive; anything that
+// is not an operator goes through the Tokenizer, so words match indexed
+// terms. Misplaced operators and empty groups are ignored.
+struct Query {
+    struct Node {
+        enum class Kind { Term, Phrase, Near, And, Or };
+
+        Kind kind = Kind::Or;
+        // Term: the word; Phrase: words in order; Near: sorted, unique
+        std::vector<std::string> words;
+        // Near only: largest distance between the first and last word
+        uint32_t distance = 0;
+        // And, Or: operands. Or keeps its terms first, sorted and unique.
+        std::vector<Node> children;
+        // And only: operands whose documents are excluded
+        std::vector<Node> excluded;
+
+        // An Or without operands matches nothing
+        bool empty() const { return kind == Kind::Or && children.empty(); }
+        bool operator==(const Node& other) const;
+    };
+
+    Node root;
+
+    bool empty() const { return root.empty(); }
+
+    // True if the query is one word or an OR of words; words is set to
+    // them, sorted and unique.
+    bool PlainWords(std::vector<std::string>& words) const;
+
+    // Canonical form: equal for requests that parse to the same tree
+    std::string ToString() const;
+
+    static Query Parse(std::string_view request);
+};
+
+#endif // QUERY_H
@@ -0,0 +1,16 @@
+#ifndef RELATIVEINDEX_H
+#define RELATIVEINDEX_H
+
+#include <cstddef>
+
+// A search result: a document and its rank relative to the best match
+struct RelativeIndex {
+    size_t doc_id;
+    float rank;
+
+    bool operator==(const RelativeIndex& other) const {
+        return (doc_id == other.doc_id && rank == other.rank);
+    }
+};
+
+#endif // RELATIVEINDEX_H
@@ -0,0 +1,46 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include "RelativeIndex.h"
+#include "ShardedLru.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Search results by normalized query, shared by concurrent searches.
+//
+// Every entry remembers the index generation it was computed on and only
+// answers lookups for that generation; an entry found for another one is
+// dropped, so publishing a new snapshot retires the old results as they
+// are asked for.
+class ResultCache {
+public:
+    struct Cached {
+        uint64_t generation;
+        std::vector<RelativeIndex> results;
+    };
+    using Stats = ShardedLru<std::string, Cached>::Stats;
+
+    // capacity_bytes == 0 disables the cache: nothing is stored, every
+    // lookup misses.
+    explicit ResultCache(size_t capacity_bytes, size_t shard_count = 16)
+        : lru(capacity_bytes, shard_count) {}
+
+    bool Enabled() const { return lru.Enabled(); }
+
+    // Copies the results of query at generation into results; false if
+    // there are none
+    bool Get(const std::string& query, uint64_t generation, std::vector<RelativeIndex>& results);
+
+    // Stores results, evicting the least recently used entries of the shard
+    // to stay within the cap. Results too large for a shard are not kept.
+    void Put(const std::string& query, uint64_t generation, const std::vector<RelativeIndex>& results);
+
+    Stats GetStats() const { return lru.GetStats(); }
+
+private:
+    ShardedLru<std::string, Cached> lru;
+};
+
+#endif // RESULTCACHE_H
@@ -1,29 +1,130 @@
+#ifndef SEARCHSERVER_H
+#define SEARCHSERVER_H
+
 #include "InvertedIndex.h"
+#include "Query.h"
+#include "RelativeIndex.h"
+#include "ResultCache.h"
+#include "ThreadPool.h"
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <vector>
 
-struct RelativeIndex {
-    size_t doc_id;
-    float rank;
+// Keeps the k best of a stream of ranked documents in a bounded min-heap:
+// higher rank first, lower doc_id first among equal ranks. k == 0 keeps
+// every document.
+class TopK {
+public:
+    explicit TopK(size_t k) : k(k) {}
+
+    void Push(const RelativeIndex& doc);
+
+    // Whether k documents are held; only then does Worst exist
+    bool Full() const { return k > 0 && heap.size() == k; }
+    const RelativeIndex& Worst() const { return heap.front(); }
+
+    // The documents kept, best first; leaves the collector empty
+    std::vector<RelativeIndex> Take();
 
-    bool operator==(const RelativeIndex& other) const {
-        return (doc_id == other.doc_id && rank == other.rank);
-    }
+private:
+    size_t k;
+    // Max-heap under "ranks better", so the worst document is on top
+    std::vector<RelativeIndex> heap;
 };
 
 class SearchServer {
 public:
-    SearchServer(InvertedIndex& idx) : _index(idx) {}
+    // max_responses caps the results per request; 0 returns every match.
+    // cache_bytes caps the memory of the result cache; 0 disables it.
+    // thread_count sizes the pool batches are searched on; 0 means
+    // hardware_concurrency.
+    SearchServer(InvertedIndex& idx, size_t max_responses = 0, size_t cache_bytes = 0, size_t thread_count = 0)
+        : _index(idx), _max_responses(max_responses), _cache(cache_bytes), _thread_count(thread_count) {}
 
+    // Results per request, in request order. The requests of a batch are
+    // searched in parallel.
     std::vector<std::vector<RelativeIndex>> search(const std::vector<std::string>& input_requests);
 
+    ResultCache::Stats cacheStats() const { return _cache.GetStats(); }
+
+    // A lone request of plain words whose lists hold at least this many
+    // postings in total is ranked in doc_id chunks in parallel; 0 never
+    // splits a request.
+    void setPartitionPostings(size_t postings) { _partition_postings = postings; }
+
 private:
     InvertedIndex& _index;
+    size_t _max_responses;
+    // Results by normalized query, for the generation they were computed on
+    ResultCache _cache;
+    size_t _thread_count;
+    size_t _partition_postings = 1 << 16;
+    // Created by the first batch of more than one request
+    std::unique_ptr<ThreadPool> _pool;
+    std::once_flag _pool_created;
 
-    std::vector<std::string> processQuery(const std::string& request);
-    std::vector<size_t> findMatchingDocs(const std::vector<std::string>& words);
+    using LiveSegment = InvertedIndex::LiveSegment;
+
+    ThreadPool& pool();
+    Query processQuery(const std::string& request);
+    // Ranked results of one request against the snapshot; partition allows
+    // splitting it over the pool
+    std::vector<RelativeIndex> searchRequest(const InvertedIndex::Snapshot& snapshot, const std::string& request,
+                                             bool partition);
+    // Term ids of the query words known to the segment
+    std::vector<uint32_t> resolveTerms(const LiveSegment& segment, const std::vector<std::string>& words);
+    // Posting lists of the terms, through the index's posting cache
+    std::vector<PostingList> readPostings(const LiveSegment& segment, const std::vector<uint32_t>& term_ids);
+    // Live documents of the segment in any of the lists
+    std::vector<size_t> findMatchingDocs(const LiveSegment& segment, const std::vector<PostingList>& lists);
+    // Absolute ranks (summed term frequencies) of doc_ids in the segment
     std::vector<RelativeIndex> rankDocuments(
+        const LiveSegment& segment,
         const std::vector<size_t>& doc_ids,
-        const std::vector<std::string>& words
+        const std::vector<PostingList>& lists
     );
+    // Adds the live documents of the segment containing any of the terms to
+    // top, like findMatchingDocs and rankDocuments, but document-at-a-time
+    // with Block-Max WAND: documents whose rank bound, from the list and
+    // block max_tf, cannot beat the current k-th rank are never scored,
+    // and blocks holding only such documents are never decoded.
+    // Only documents in [begin, end) are considered. shared_threshold, if
+    // given, is a k-th rank other callers reached on other ranges: it
+    // prunes here too, and this call raises it as top fills up.
+    void rankTopK(const LiveSegment& segment, const std::vector<uint32_t>& term_ids, TopK& top,
+                  uint32_t begin = 0, uint32_t end = PostingList::kEndDocId,
+                  std::atomic<float>* shared_threshold = nullptr);
+    // rankTopK over every segment, with the doc_id space split into chunks
+    // ranked on the pool into local heaps and merged into top. Returns
+    // false, doing nothing, if the words are too rare to be worth it.
+    bool rankPartitioned(const InvertedIndex::Snapshot& snapshot, const std::vector<std::string>& words, TopK& top);
+    // Live documents of the segment matching node, sorted by doc_id. A
+    // document's rank sums the ranks of the operands it matches.
+    std::vector<RelativeIndex> evaluate(const LiveSegment& segment, const Query::Node& node);
+    // Upper bound on the documents of the segment matching node, from the
+    // posting list sizes
+    size_t estimateDocs(const LiveSegment& segment, const Query::Node& node);
+    // Documents matching every operand of an And node and none of its
+    // excluded ones. Operands are applied rarest first, so the candidates
+    // only shrink; terms are probed with block skipping instead of being
+    // decoded in full.
+    std::vector<RelativeIndex> matchAll(const LiveSegment& segment, const Query::Node& node);
+    // Live documents of the segment matching a phrase or NEAR node,
+    // ranked by the number of matches. Positions are only decoded for the
+    // documents containing all of the node's words. Without positions in
+    // the segment, containing all words is taken as a match.
+    std::vector<RelativeIndex> matchProximity(const LiveSegment& segment, const Query::Node& clause);
+    // Adds the ranks of more to ranked_docs; both are sorted by doc_id
+    void mergeRanks(std::vector<RelativeIndex>& ranked_docs, const std::vector<RelativeIndex>& more);
+    // Keeps the documents of ranked_docs also in more, adding their ranks
+    void intersectRanks(std::vector<RelativeIndex>& ranked_docs, const std::vector<RelativeIndex>& more);
+    // Drops the documents of ranked_docs that are in excluded
+    void subtractDocs(std::vector<RelativeIndex>& ranked_docs, const std::vector<RelativeIndex>& excluded);
+    // Scales ranks, sorted best first, relative to the best one
+    void normalizeRanks(std::vector<RelativeIndex>& ranked_docs);
 };
+
+#endif // SEARCHSERVER_H
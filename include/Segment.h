@@ -0,0 +1,205 @@
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+#include "MappedFile.h"
+#include "PositionList.h"
+#include "PostingList.h"
+#include "TermFilter.h"
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Immutable index segment: term dictionary, postings and document table in
+// one buffer that is used in place, without deserialization. Segments live
+// either in memory or in a file mapped with mmap.
+//
+//   header (80 bytes): magic, version, header CRC, file size, term count,
+//                      document count, section offsets, body CRC, flags,
+//                      term filter offset and size
+//   postings:          per term an encoded PostingList, followed by its
+//                      PositionList if the segment has positions
+//   term table:        per term { postings offset, postings size,
+//                      term size, term offset, positions size },
+//                      sorted by term bytes
+//   term strings
+//   document table:    per document { doc_id, exists, deleted, path, size,
+//                      mtime, content hash }, sorted by doc_id
+//   document paths
+//   term filter:       TermFilter over all terms
+//
+// Integers are little-endian. Term ids of a segment are positions in its
+// term table. All CRCs are CRC-32C.
+class Segment {
+public:
+    static constexpr uint32_t kVersion = 5;
+    static constexpr uint32_t kNoTerm = std::numeric_limits<uint32_t>::max();
+
+    struct DocumentEntry {
+        uint32_t doc_id;
+        bool exists;
+        // Removed with InvertedIndex::DeleteDocument; it has no postings
+        bool deleted;
+        std::string_view path;
+        uint64_t size;
+        int64_t mtime;
+        uint64_t content_hash;
+    };
+
+    // Maps a segment file and validates its header and layout. The body CRC
+    // is checked too if verify_checksum is set; that reads the whole file.
+    // Without it, the postings and positions of a term are checked on first
+    // access and decoded with bounds checks.
+    // Throws std::runtime_error if the file is missing or malformed.
+    static std::shared_ptr<const Segment> Open(const std::string& path, bool verify_checksum = false);
+
+    size_t TermCount() const { return term_count; }
+    size_t DocumentCount() const { return doc_count; }
+    size_t ByteSize() const { return size; }
+    // Whether every term carries the token positions of its postings
+    bool HasPositions() const { return has_positions; }
+
+    std::string_view Term(uint32_t term_id) const;
+    // Binary search in the term table; kNoTerm if absent. Terms the filter
+    // rules out are not searched for.
+    uint32_t FindTerm(std::string_view term) const;
+    // False only if the segment certainly lacks the term; reads just the
+    // filter, one cache line
+    bool MayContainTerm(std::string_view term) const { return term_filter.MayContain(term); }
+    // View into the mapping, valid while the segment is alive. Throws
+    // std::runtime_error if the term's list headers are out of bounds.
+    PostingList Postings(uint32_t term_id) const;
+    // Same; empty if the segment has no positions
+    PositionList Positions(uint32_t term_id) const;
+
+    DocumentEntry Document(size_t index) const;
+    // Binary search in the document table
+    bool ContainsDocument(uint32_t doc_id) const;
+
+    bool VerifyChecksum() const;
+
+private:
+    friend class SegmentWriter;
+
+    Segment() = default;
+
+    // Validates the header and sets up the section offsets
+    void Init(const std::string& name, bool verify_checksum);
+
+    struct TermEntry {
+        uint64_t postings_offset;
+        uint32_t postings_size;
+        uint32_t term_size;
+        uint64_t term_offset;
+        uint32_t positions_size;
+    };
+
+    TermEntry ReadTermEntry(uint32_t term_id) const;
+    // Verifies the list headers of a term the first time it is read
+    void CheckTerm(uint32_t term_id, const TermEntry& entry) const;
+
+    std::string name;
+    MappedFile file;
+    std::string memory;
+    const uint8_t* base = nullptr;
+    size_t size = 0;
+    size_t term_count = 0;
+    size_t doc_count = 0;
+    bool has_positions = false;
+    uint64_t term_table_offset = 0;
+    uint64_t doc_table_offset = 0;
+    uint32_t body_crc = 0;
+    TermFilter term_filter;
+    // Per term, whether CheckTerm passed; racing checks just repeat it
+    mutable std::unique_ptr<std::atomic<bool>[]> checked_terms;
+};
+
+// Writes a segment front to back, into memory or into a file. Postings are
+// streamed out as terms are added; the term and document tables are written
+// by Finish. Files are written under a temporary name and renamed into
+// place, so a crash never leaves a truncated segment behind.
+class SegmentWriter {
+public:
+    // Bytes of a streamed term a file-backed writer holds in memory per
+    // section; the rest waits in a scratch file next to the segment.
+    static constexpr size_t kTermBufferBytes = 1 << 20;
+
+    // In-memory segment. With positions set, every term must come with
+    // the positions of its postings; without, none may.
+    explicit SegmentWriter(bool positions = false);
+    explicit SegmentWriter(const std::string& path, bool positions = false);
+    // Keeps string literals from converting to bool
+    explicit SegmentWriter(const char* path, bool positions = false)
+        : SegmentWriter(std::string(path), positions) {}
+
+    // Terms must be added in ascending byte order; their ids in the
+    // finished segment are the order of the calls.
+    void AddTerm(std::string_view term, const PostingList& postings,
+                 const PositionList& positions = PositionList());
+
+    // Same, for lists too long to hold decoded: BeginTerm, then AddPosting
+    // for every posting in doc_id order, with its tf positions if the
+    // segment has positions, then EndTerm. Postings are encoded block by
+    // block as they come. EndTerm returns the bytes written; a term
+    // without postings is left out.
+    void BeginTerm(std::string_view term);
+    void AddPosting(const Posting& posting, const uint32_t* positions = nullptr);
+    size_t EndTerm();
+
+    // Documents must be added in ascending doc_id order.
+    void AddDocument(uint32_t doc_id, bool exists, std::string_view path, uint64_t size,
+                     int64_t mtime, uint64_t content_hash, bool deleted = false);
+
+    size_t TermCount() const { return term_count; }
+
+    // Completes the segment and opens it
+    std::shared_ptr<const Segment> Finish();
+
+    ~SegmentWriter();
+
+private:
+    class TermBuffer;
+
+    void Write(const void* data, size_t bytes);
+    void Pad(size_t alignment);
+    // Checks the term order and adds its table entry; its postings, then
+    // its positions, are to be written next.
+    void AddTermEntry(std::string_view term, size_t postings_size, size_t positions_size);
+
+    bool in_memory;
+    bool positions;
+    std::string path;
+    std::string temp_path;
+    std::ofstream out;
+    std::string buffer;
+    uint64_t offset = 0;
+    uint32_t body_crc = 0;
+
+    // Serialized term table entries and term bytes
+    std::string term_table;
+    std::string term_strings;
+    std::string last_term;
+    uint64_t term_count = 0;
+    // TermFilter hashes of the terms, for the filter written by Finish
+    std::vector<uint64_t> term_hashes;
+    // The term being streamed and its encoded sections so far
+    std::string streamed_term;
+    std::unique_ptr<TermBuffer> streamed_postings;
+    std::unique_ptr<TermBuffer> streamed_positions;
+    std::optional<PostingListEncoder> postings_encoder;
+    std::optional<PositionListEncoder> positions_encoder;
+    // Serialized document table entries, with path offsets relative to
+    // document_paths
+    std::string document_table;
+    std::string document_paths;
+    uint64_t document_count = 0;
+    uint32_t last_doc_id = 0;
+};
+
+#endif // SEGMENT_H
@@ -0,0 +1,148 @@
+#ifndef SHARDEDLRU_H
+#define SHARDEDLRU_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Memory-capped LRU map shared by concurrent readers. Keys are spread over
+// independently locked shards, each an LRU list holding its share of the
+// cap; callers state the approximate footprint of every value they store.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class ShardedLru {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    // capacity_bytes == 0 disables the cache: nothing is stored, every
+    // lookup misses.
+    explicit ShardedLru(size_t capacity_bytes, size_t shard_count = 16) {
+        if (shard_count == 0) shard_count = 1;
+
+        shards.reserve(shard_count);
+        for (size_t i = 0; i < shard_count; ++i) shards.push_back(std::make_unique<Shard>());
+        SetCapacity(capacity_bytes);
+    }
+
+    // Changes the memory cap, evicting entries over the new one
+    void SetCapacity(size_t capacity_bytes) {
+        size_t capacity = capacity_bytes / shards.size();
+        shard_capacity.store(capacity, std::memory_order_relaxed);
+
+        for (const auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            Evict(*shard, capacity);
+        }
+    }
+
+    size_t ShardCapacity() const { return shard_capacity.load(std::memory_order_relaxed); }
+    bool Enabled() const { return ShardCapacity() > 0; }
+
+    // Passes the value of key to use, under the shard's lock. If use
+    // accepts it, the entry becomes the most recently used one and the
+    // lookup counts as a hit; a rejected entry is dropped.
+    template <typename Use>
+    bool Find(const Key& key, Use&& use) {
+        if (Enabled()) {
+            Shard& shard = ShardOf(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            auto found = shard.entries.find(key);
+            if (found != shard.entries.end()) {
+                auto entry = found->second;
+                if (use(std::as_const(entry->value))) {
+                    shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+                    hits.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+                Erase(shard, entry);
+            }
+        }
+
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Stores value under key, evicting the least recently used entries of
+    // the shard to stay within the cap, unless keep says the value already
+    // stored should stay. Values too large for a shard are not kept.
+    template <typename Keep>
+    void Put(const Key& key, Value value, size_t bytes, Keep&& keep) {
+        size_t capacity = ShardCapacity();
+        if (bytes > capacity) return;
+
+        Shard& shard = ShardOf(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto found = shard.entries.find(key);
+        if (found != shard.entries.end()) {
+            if (keep(std::as_const(found->second->value))) return;
+            Erase(shard, found->second);
+        }
+
+        Evict(shard, capacity - bytes);
+        shard.lru.push_front({key, std::move(value), bytes});
+        shard.entries.emplace(key, shard.lru.begin());
+        shard.bytes += bytes;
+    }
+
+    Stats GetStats() const {
+        Stats stats;
+        stats.hits = hits.load(std::memory_order_relaxed);
+        stats.misses = misses.load(std::memory_order_relaxed);
+        for (const auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            stats.entries += shard->lru.size();
+            stats.bytes += shard->bytes;
+        }
+        return stats;
+    }
+
+private:
+    struct Entry {
+        Key key;
+        Value value;
+        size_t bytes;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        // Most recently used first
+        std::list<Entry> lru;
+        std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> entries;
+        size_t bytes = 0;
+    };
+
+    Shard& ShardOf(const Key& key) {
+        return *shards[Hash()(key) % shards.size()];
+    }
+
+    // Unlinks an entry; the shard's mutex is held
+    static void Erase(Shard& shard, typename std::list<Entry>::iterator entry) {
+        shard.bytes -= entry->bytes;
+        shard.entries.erase(entry->key);
+        shard.lru.erase(entry);
+    }
+
+    static void Evict(Shard& shard, size_t capacity) {
+        while (shard.bytes > capacity) Erase(shard, std::prev(shard.lru.end()));
+    }
+
+    std::atomic<size_t> shard_capacity{0};
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+};
+
+#endif // SHARDEDLRU_H
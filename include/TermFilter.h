@@ -0,0 +1,50 @@
+#ifndef TERMFILTER_H
+#define TERMFILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Blocked Bloom filter over the terms of a segment: a negative answer
+// means the term is certainly absent, so the term table need not be
+// searched. Every term sets kProbes bits within one 64-byte block, so a
+// lookup touches a single cache line. At kBitsPerTerm bits per term about
+// 1% of absent terms pass.
+//
+// The hash is part of the segment format and must stay stable. Like
+// PostingList, a filter either owns its bytes or is a view into a segment.
+class TermFilter {
+public:
+    static constexpr size_t kBlockBytes = 64;
+    static constexpr size_t kBitsPerTerm = 10;
+    static constexpr unsigned kProbes = 7;
+
+    static uint64_t Hash(std::string_view term);
+
+    // An empty filter may contain any term
+    TermFilter() = default;
+    // Filter over the terms with the given hashes
+    explicit TermFilter(const std::vector<uint64_t>& hashes);
+    // Non-owning view; bytes must outlive it. size must be a multiple of
+    // kBlockBytes.
+    static TermFilter View(const uint8_t* bytes, size_t size);
+
+    bool MayContain(uint64_t hash) const;
+    bool MayContain(std::string_view term) const { return MayContain(Hash(term)); }
+
+    const uint8_t* Bytes() const { return bytes; }
+    size_t ByteSize() const { return byte_size; }
+
+    TermFilter(const TermFilter&) = delete;
+    TermFilter& operator=(const TermFilter&) = delete;
+    TermFilter(TermFilter&& other) noexcept;
+    TermFilter& operator=(TermFilter&& other) noexcept;
+
+private:
+    const uint8_t* bytes = nullptr;
+    size_t byte_size = 0;
+    std::vector<uint8_t> owned;
+};
+
+#endif // TERMFILTER_H
@@ -0,0 +1,31 @@
+#ifndef TEXTKERNEL_H
+#define TEXTKERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Byte classification shared by document and query tokenization.
+// Word bytes are ASCII letters and digits plus every byte >= 0x80, so UTF-8
+// encoded words stay whole; every other ASCII byte separates words.
+enum class TextKernelIsa {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+// Best implementation supported by the CPU we are running on.
+TextKernelIsa DetectTextKernelIsa();
+
+const char* TextKernelIsaName(TextKernelIsa isa);
+
+// Copies text[0, size) into folded with ASCII letters lowercased and sets
+// bit (i % 64) of word_mask[i / 64] for every word byte i. word_mask must
+// hold (size + 63) / 64 entries; bits past size are cleared.
+void ClassifyAndFold(const char* text, size_t size, char* folded, uint64_t* word_mask);
+
+// Same, with an explicit implementation. An implementation the CPU does not
+// support falls back to the best supported one.
+void ClassifyAndFold(TextKernelIsa isa, const char* text, size_t size,
+                     char* folded, uint64_t* word_mask);
+
+#endif // TEXTKERNEL_H
@@ -0,0 +1,56 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    // thread_count == 0 means std::thread::hardware_concurrency()
+    explicit ThreadPool(size_t thread_count = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(std::function<void()> task);
+
+    // Blocks until every submitted task has finished. Rethrows the first
+    // exception thrown by a task, if any.
+    void Wait();
+
+    // Splits [0, count) into batches of batch_size and runs body(begin, end)
+    // for each of them on the pool, then waits for completion.
+    void ParallelFor(size_t count, size_t batch_size,
+                     const std::function<void(size_t, size_t)>& body);
+
+    // Runs body(i) for every i in [0, count) on the pool and the calling
+    // thread. Indexes are handed out one at a time from a shared counter,
+    // so threads done with cheap items take over the rest instead of
+    // idling behind a static split. Unlike ParallelFor it waits for its own
+    // items only, so concurrent callers may share the pool, and it makes
+    // progress even when every worker is busy. Rethrows the first
+    // exception thrown by body; the remaining items are then skipped.
+    void ForEach(size_t count, const std::function<void(size_t)>& body);
+
+    size_t Size() const { return workers.size(); }
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex queue_mutex;
+    std::condition_variable task_available;
+    std::condition_variable tasks_done;
+    size_t pending_tasks = 0;
+    bool stopping = false;
+    std::exception_ptr first_error;
+};
+
+#endif // THREADPOOL_H
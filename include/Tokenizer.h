@@ -0,0 +1,40 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include "TextKernel.h"
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Splits text into lowercase words. Words are runs of ASCII letters, digits
+// and non-ASCII (UTF-8) bytes; everything else separates them. Documents and
+// queries both go through this class, so they are always tokenized the same
+// way.
+//
+// The whole text is classified and case-folded in one vectorized pass up
+// front; tokens are views into the tokenizer's folded copy and stay valid
+// for the tokenizer's lifetime.
+class Tokenizer {
+public:
+    explicit Tokenizer(std::string_view text, TextKernelIsa isa = DetectTextKernelIsa());
+
+    // Stores the next token in token; returns false at the end of the text.
+    bool Next(std::string_view& token);
+
+private:
+    // Next offset where the text switches between word and separator bytes.
+    bool NextBoundary(size_t& offset);
+
+    std::unique_ptr<char[]> folded;
+    size_t size;
+    std::vector<uint64_t> word_mask;
+
+    // Boundary bits of the current mask block not consumed yet
+    uint64_t boundaries = 0;
+    uint64_t carry = 0;
+    size_t block = 0;
+};
+
+#endif // TOKENIZER_H
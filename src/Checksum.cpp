@@ -0,0 +1,73 @@
+#include "Checksum.h"
+
+#include <array>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CHECKSUM_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr uint32_t kPolynomial = 0x82F63B78u;  // reversed Castagnoli
+
+const std::array<uint32_t, 256>& Table() {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> result{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ ((crc & 1) ? kPolynomial : 0);
+            }
+            result[i] = crc;
+        }
+        return result;
+    }();
+    return table;
+}
+
+uint32_t Crc32cScalar(uint32_t crc, const uint8_t* data, size_t size) {
+    const auto& table = Table();
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef CHECKSUM_X86
+
+__attribute__((target("sse4.2")))
+uint32_t Crc32cSSE42(uint32_t crc, const uint8_t* data, size_t size) {
+#ifdef __x86_64__
+    uint64_t crc64 = crc;
+    for (; size >= 8; data += 8, size -= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = static_cast<uint32_t>(crc64);
+#endif
+    for (; size > 0; ++data, --size) {
+        crc = _mm_crc32_u8(crc, *data);
+    }
+    return crc;
+}
+
+bool HasSSE42() {
+    static const bool supported = __builtin_cpu_supports("sse4.2");
+    return supported;
+}
+
+#endif // CHECKSUM_X86
+
+} // namespace
+
+uint32_t Crc32c(uint32_t crc, const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+#ifdef CHECKSUM_X86
+    if (HasSSE42()) return ~Crc32cSSE42(crc, bytes, size);
+#endif
+    return ~Crc32cScalar(crc, bytes, size);
+}
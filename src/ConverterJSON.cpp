@@ -2,6 +2,7 @@
 #include <filesystem>
 #include <iostream>
 #include <fstream>
+#include <limits>
 
 using std::runtime_error;
 using std::exception;
@@ -15,12 +16,18 @@ using std::ios;
 namespace fs = std::filesystem;
 
 void ConverterJSON::loadConfig() const {
-    if (config_loaded) return;
+    std::error_code ec;
+    auto mtime = fs::last_write_time("config.json", ec);
+
+    // Keep serving the cached config unless the file was rewritten since.
+    if (config_loaded && (ec || mtime == config_mtime)) return;
 
     if (!fs::exists("config.json")) {
         throw runtime_error("config file is missing");
     }
 
+    config_loaded = false;
+
     config_cache = safeParse("config.json");
 
     if (config_cache.empty()) {
@@ -44,6 +51,7 @@ void ConverterJSON::loadConfig() const {
         throw runtime_error("config file: 'files' must be non-empty array");
     }
 
+    config_mtime = mtime;
     config_loaded = true;
 }
 
@@ -78,6 +86,59 @@ vector<string> ConverterJSON::GetTextDocuments() const {
     return config_cache["files"].get<vector<string>>();
 }
 
+int ConverterJSON::GetResponsesLimit() const {
+    loadConfig();
+    const auto& limit = config_cache["config"]["max_responses"];
+    if (!limit.is_number_integer() || limit.get<int64_t>() < 1 || limit.get<int64_t>() > std::numeric_limits<int>::max()) {
+        throw runtime_error("config file: 'max_responses' must be a positive integer");
+    }
+    return limit.get<int>();
+}
+
+string ConverterJSON::GetIndexFile() const {
+    loadConfig();
+    const auto& config = config_cache["config"];
+    if (!config.contains("index_file")) return {};
+    return config["index_file"].get<string>();
+}
+
+size_t ConverterJSON::getMegabytes(const string& field) const {
+    loadConfig();
+    const auto& config = config_cache["config"];
+    if (!config.contains(field)) return 0;
+
+    double megabytes = config[field].get<double>();
+    if (megabytes < 0) {
+        throw runtime_error("config file: '" + field + "' must not be negative");
+    }
+    return static_cast<size_t>(megabytes * 1024 * 1024);
+}
+
+size_t ConverterJSON::GetIndexMemoryBudget() const {
+    return getMegabytes("index_memory_mb");
+}
+
+string ConverterJSON::GetIndexSpillDirectory() const {
+    loadConfig();
+    const auto& config = config_cache["config"];
+    if (!config.contains("index_spill_dir")) return {};
+    return config["index_spill_dir"].get<string>();
+}
+
+size_t ConverterJSON::GetResultCacheBudget() const {
+    return getMegabytes("result_cache_mb");
+}
+
+size_t ConverterJSON::GetPostingCacheBudget() const {
+    return getMegabytes("posting_cache_mb");
+}
+
+bool ConverterJSON::GetIndexPositions() const {
+    loadConfig();
+    const auto& config = config_cache["config"];
+    return config.contains("index_positions") && config["index_positions"].get<bool>();
+}
+
 vector<string> ConverterJSON::GetRequests() const {
     loadRequests();
 
@@ -0,0 +1,174 @@
+#include "ExternalSort.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+
+template <typename T>
+static void WriteValue(std::ofstream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool ReadValue(std::ifstream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+RunWriter::RunWriter(const std::string& path)
+    : path(path), out(path, std::ios::binary | std::ios::trunc) {
+    if (!out) throw std::runtime_error("Could not create " + path);
+}
+
+void RunWriter::Add(std::string_view term, const std::vector<Posting>& postings,
+                    const std::vector<uint32_t>& positions) {
+    WriteValue<uint32_t>(out, static_cast<uint32_t>(term.size()));
+    out.write(term.data(), static_cast<std::streamsize>(term.size()));
+    WriteValue<uint32_t>(out, static_cast<uint32_t>(postings.size()));
+    WriteValue<uint32_t>(out, static_cast<uint32_t>(positions.size()));
+
+    const uint32_t* position = positions.data();
+    for (const Posting& posting : postings) {
+        WriteValue<uint32_t>(out, posting.doc_id);
+        WriteValue<uint32_t>(out, posting.tf);
+        if (positions.empty()) continue;
+        out.write(reinterpret_cast<const char*>(position), static_cast<std::streamsize>(posting.tf * sizeof(uint32_t)));
+        position += posting.tf;
+    }
+}
+
+void RunWriter::Finish() {
+    out.close();
+    if (!out) throw std::runtime_error("Could not write " + path);
+}
+
+RunReader::RunReader(const std::string& path)
+    : path(path), in(path, std::ios::binary) {
+    if (!in) throw std::runtime_error("Could not open " + path);
+}
+
+bool RunReader::Next() {
+    while (NextPosting()) {}
+
+    uint32_t term_size;
+    if (!ReadValue(in, term_size)) return false;
+
+    uint32_t count = 0;
+    uint32_t position_count = 0;
+    term.resize(term_size);
+    in.read(term.data(), term_size);
+    ReadValue(in, count);
+    ReadValue(in, position_count);
+    if (!in) throw std::runtime_error("Truncated run file " + path);
+
+    postings_left = count;
+    has_positions = position_count > 0;
+    positions.clear();
+    return true;
+}
+
+bool RunReader::NextPosting() {
+    if (postings_left == 0) return false;
+
+    ReadValue(in, current.doc_id);
+    ReadValue(in, current.tf);
+    if (has_positions) {
+        positions.resize(current.tf);
+        in.read(reinterpret_cast<char*>(positions.data()), static_cast<std::streamsize>(current.tf * sizeof(uint32_t)));
+    }
+    if (!in) throw std::runtime_error("Truncated run file " + path);
+
+    --postings_left;
+    return true;
+}
+
+RunMerger::RunMerger(const std::vector<std::string>& paths) {
+    for (const auto& path : paths) {
+        auto reader = std::make_unique<RunReader>(path);
+        if (!reader->Next()) continue;
+        heap.push_back(readers.size());
+        readers.push_back(std::move(reader));
+    }
+    std::make_heap(heap.begin(), heap.end(), [&](size_t a, size_t b) {
+        return readers[a]->Term() > readers[b]->Term();
+    });
+}
+
+bool RunMerger::NextTerm() {
+    auto later = [&](size_t a, size_t b) { return readers[a]->Term() > readers[b]->Term(); };
+    auto after = [&](size_t a, size_t b) { return readers[a]->Current().doc_id > readers[b]->Current().doc_id; };
+
+    // Readers of the previous term move on to their next one.
+    finished.insert(finished.end(), term_readers.begin(), term_readers.end());
+    term_readers.clear();
+    for (size_t i : finished) {
+        if (!readers[i]->Next()) continue;
+        heap.push_back(i);
+        std::push_heap(heap.begin(), heap.end(), later);
+    }
+    finished.clear();
+    if (heap.empty()) return false;
+
+    term = readers[heap.front()]->Term();
+    while (!heap.empty() && readers[heap.front()]->Term() == term) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        size_t i = heap.back();
+        heap.pop_back();
+
+        if (readers[i]->NextPosting()) {
+            term_readers.push_back(i);
+            std::push_heap(term_readers.begin(), term_readers.end(), after);
+        } else {
+            finished.push_back(i);
+        }
+    }
+    return true;
+}
+
+bool RunMerger::NextPosting(Posting& posting, std::vector<uint32_t>& positions) {
+    if (term_readers.empty()) return false;
+
+    auto after = [&](size_t a, size_t b) { return readers[a]->Current().doc_id > readers[b]->Current().doc_id; };
+    std::pop_heap(term_readers.begin(), term_readers.end(), after);
+    size_t i = term_readers.back();
+    RunReader& reader = *readers[i];
+    posting = reader.Current();
+    positions.assign(reader.Positions().begin(), reader.Positions().end());
+
+    if (reader.NextPosting()) {
+        std::push_heap(term_readers.begin(), term_readers.end(), after);
+    } else {
+        term_readers.pop_back();
+        finished.push_back(i);
+    }
+    return true;
+}
+
+TempDirectory::TempDirectory(const std::string& parent) {
+    static std::atomic<uint64_t> counter{0};
+    std::random_device random;
+
+    std::filesystem::path base = parent;
+    if (base.empty()) {
+        base = std::filesystem::temp_directory_path();
+    } else {
+        std::filesystem::create_directories(base);
+    }
+    while (true) {
+        auto candidate = base / ("searchengine-" + std::to_string(random()) + "-" + std::to_string(counter++));
+        if (std::filesystem::create_directory(candidate)) {
+            path = candidate.string();
+            return;
+        }
+    }
+}
+
+TempDirectory::~TempDirectory() {
+    std::error_code ec;
+    std::filesystem::remove_all(path, ec);
+}
+
+std::string TempDirectory::File(const std::string& name) const {
+    return (std::filesystem::path(path) / name).string();
+}
@@ -0,0 +1,212 @@
+#include "Intersect.h"
+#include "Bits.h"
+
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define INTERSECT_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Galloping pays off once the longer array is this many times longer
+// than the shorter one (measured with intersect_bench).
+constexpr size_t kGallopRatio = 64;
+
+// Scalar merge of a[i, a_size) and b[j, b_size); n matches were found
+// before. Returns the total.
+size_t MergeFrom(const uint32_t* a, size_t a_size, size_t i, const uint32_t* b, size_t b_size, size_t j,
+                 uint32_t* a_matches, uint32_t* b_matches, size_t n) {
+    while (i < a_size && j < b_size) {
+        if (a[i] < b[j]) {
+            ++i;
+        } else if (b[j] < a[i]) {
+            ++j;
+        } else {
+            a_matches[n] = static_cast<uint32_t>(i++);
+            b_matches[n] = static_cast<uint32_t>(j++);
+            ++n;
+        }
+    }
+    return n;
+}
+
+size_t IntersectGallop(const uint32_t* small, size_t small_size, const uint32_t* large, size_t large_size,
+                       uint32_t* small_matches, uint32_t* large_matches) {
+    size_t n = 0;
+    size_t at = 0;
+    for (size_t i = 0; i < small_size && at < large_size; ++i) {
+        uint32_t target = small[i];
+
+        size_t low = at;
+        size_t high = at;
+        for (size_t step = 1; high < large_size && large[high] < target; step *= 2) {
+            low = high + 1;
+            high += step;
+        }
+        high = std::min(high, large_size);
+        at = static_cast<size_t>(std::lower_bound(large + low, large + high, target) - large);
+
+        if (at < large_size && large[at] == target) {
+            small_matches[n] = static_cast<uint32_t>(i);
+            large_matches[n] = static_cast<uint32_t>(at++);
+            ++n;
+        }
+    }
+    return n;
+}
+
+// Set bits of a_mask and b_mask pair up in order: both arrays are strictly
+// increasing, so the k-th match in one block is the k-th in the other.
+inline size_t EmitMatches(unsigned a_mask, unsigned b_mask, size_t i, size_t j,
+                          uint32_t* a_matches, uint32_t* b_matches, size_t n) {
+    while (a_mask != 0) {
+        a_matches[n] = static_cast<uint32_t>(i + CountTrailingZeros(a_mask));
+        b_matches[n] = static_cast<uint32_t>(j + CountTrailingZeros(b_mask));
+        ++n;
+        a_mask &= a_mask - 1;
+        b_mask &= b_mask - 1;
+    }
+    return n;
+}
+
+#ifdef INTERSECT_X86
+
+// Lanes of x equal to any lane of y
+__attribute__((target("sse2")))
+inline unsigned MatchMask4(__m128i x, __m128i y) {
+    __m128i m = _mm_cmpeq_epi32(x, y);
+    m = _mm_or_si128(m, _mm_cmpeq_epi32(x, _mm_shuffle_epi32(y, _MM_SHUFFLE(0, 3, 2, 1))));
+    m = _mm_or_si128(m, _mm_cmpeq_epi32(x, _mm_shuffle_epi32(y, _MM_SHUFFLE(1, 0, 3, 2))));
+    m = _mm_or_si128(m, _mm_cmpeq_epi32(x, _mm_shuffle_epi32(y, _MM_SHUFFLE(2, 1, 0, 3))));
+    return static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(m)));
+}
+
+__attribute__((target("sse2")))
+size_t IntersectSSE2(const uint32_t* a, size_t a_size, const uint32_t* b, size_t b_size,
+                     uint32_t* a_matches, uint32_t* b_matches) {
+    size_t i = 0;
+    size_t j = 0;
+    size_t n = 0;
+    while (i + 4 <= a_size && j + 4 <= b_size) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+
+        unsigned a_mask = MatchMask4(va, vb);
+        if (a_mask != 0) n = EmitMatches(a_mask, MatchMask4(vb, va), i, j, a_matches, b_matches, n);
+
+        uint32_t a_max = a[i + 3];
+        uint32_t b_max = b[j + 3];
+        if (a_max <= b_max) i += 4;
+        if (b_max <= a_max) j += 4;
+    }
+    return MergeFrom(a, a_size, i, b, b_size, j, a_matches, b_matches, n);
+}
+
+// rotations[r - 1] rotates the lanes of a vector by r
+__attribute__((target("avx2")))
+inline unsigned MatchMask8(__m256i x, __m256i y, const __m256i* rotations) {
+    __m256i m = _mm256_cmpeq_epi32(x, y);
+    for (int r = 0; r < 7; ++r) {
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi32(x, _mm256_permutevar8x32_epi32(y, rotations[r])));
+    }
+    return static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(m)));
+}
+
+__attribute__((target("avx2")))
+size_t IntersectAVX2(const uint32_t* a, size_t a_size, const uint32_t* b, size_t b_size,
+                     uint32_t* a_matches, uint32_t* b_matches) {
+    size_t i = 0;
+    size_t j = 0;
+    size_t n = 0;
+
+    __m256i rotations[7];
+    for (int r = 1; r < 8; ++r) {
+        rotations[r - 1] = _mm256_setr_epi32(r & 7, (r + 1) & 7, (r + 2) & 7, (r + 3) & 7,
+                                             (r + 4) & 7, (r + 5) & 7, (r + 6) & 7, (r + 7) & 7);
+    }
+
+    while (i + 8 <= a_size && j + 8 <= b_size) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j));
+
+        unsigned a_mask = MatchMask8(va, vb, rotations);
+        if (a_mask != 0) n = EmitMatches(a_mask, MatchMask8(vb, va, rotations), i, j, a_matches, b_matches, n);
+
+        uint32_t a_max = a[i + 7];
+        uint32_t b_max = b[j + 7];
+        if (a_max <= b_max) i += 8;
+        if (b_max <= a_max) j += 8;
+    }
+    return MergeFrom(a, a_size, i, b, b_size, j, a_matches, b_matches, n);
+}
+
+#endif // INTERSECT_X86
+
+bool IsSupported(IntersectKernel kernel) {
+    switch (kernel) {
+    case IntersectKernel::Merge:
+    case IntersectKernel::Gallop:
+        return true;
+#ifdef INTERSECT_X86
+    case IntersectKernel::SSE2:
+        return __builtin_cpu_supports("sse2");
+    case IntersectKernel::AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+IntersectKernel BestMergeKernel() {
+    static const IntersectKernel detected = [] {
+        if (IsSupported(IntersectKernel::AVX2)) return IntersectKernel::AVX2;
+        if (IsSupported(IntersectKernel::SSE2)) return IntersectKernel::SSE2;
+        return IntersectKernel::Merge;
+    }();
+    return detected;
+}
+
+} // namespace
+
+IntersectKernel ChooseIntersectKernel(size_t a_size, size_t b_size) {
+    size_t shorter = std::min(a_size, b_size);
+    size_t longer = std::max(a_size, b_size);
+    if (longer / kGallopRatio >= shorter) return IntersectKernel::Gallop;
+    return BestMergeKernel();
+}
+
+const char* IntersectKernelName(IntersectKernel kernel) {
+    switch (kernel) {
+    case IntersectKernel::Gallop: return "gallop";
+    case IntersectKernel::SSE2: return "sse2";
+    case IntersectKernel::AVX2: return "avx2";
+    default: return "merge";
+    }
+}
+
+size_t IntersectSorted(const uint32_t* a, size_t a_size, const uint32_t* b, size_t b_size,
+                       uint32_t* a_matches, uint32_t* b_matches) {
+    return IntersectSorted(ChooseIntersectKernel(a_size, b_size), a, a_size, b, b_size, a_matches, b_matches);
+}
+
+size_t IntersectSorted(IntersectKernel kernel, const uint32_t* a, size_t a_size,
+                       const uint32_t* b, size_t b_size, uint32_t* a_matches, uint32_t* b_matches) {
+    if (!IsSupported(kernel)) kernel = BestMergeKernel();
+
+    switch (kernel) {
+    case IntersectKernel::Gallop:
+        if (a_size <= b_size) return IntersectGallop(a, a_size, b, b_size, a_matches, b_matches);
+        return IntersectGallop(b, b_size, a, a_size, b_matches, a_matches);
+#ifdef INTERSECT_X86
+    case IntersectKernel::AVX2:
+        return IntersectAVX2(a, a_size, b, b_size, a_matches, b_matches);
+    case IntersectKernel::SSE2:
+        return IntersectSSE2(a, a_size, b, b_size, a_matches, b_matches);
+#endif
+    default:
+        return MergeFrom(a, a_size, 0, b, b_size, 0, a_matches, b_matches, 0);
+    }
+}
@@ -1,47 +1,769 @@
 #include "InvertedIndex.h"
+#include "MappedFile.h"
+#include "Tokenizer.h"
 
-#include <fstream>
-#include <thread>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
 #include <vector>
 
+// Each pool task gets a contiguous run of files; a few batches per worker
+// keeps the load balanced without paying the queue overhead per file.
+static constexpr size_t kBatchesPerWorker = 4;
+// More partitions than workers so the merge phase balances skewed terms.
+static constexpr size_t kPartitionsPerWorker = 4;
+// Rough per-term cost of a local dictionary entry beyond the term bytes:
+// hash node, key string and postings vector.
+static constexpr size_t kTermOverheadBytes = 96;
+// Memory for the words a snapshot found in none of its segments, and the
+// rough cost of one beyond its bytes: list and hash nodes, key copies.
+static constexpr size_t kAbsentTermsBytes = 256 * 1024;
+static constexpr size_t kAbsentTermBytes = 128;
+
+// 64-bit FNV-1a
+static uint64_t HashContent(std::string_view content) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : content) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static bool ByDocId(const Posting& a, const Posting& b) {
+    return a.doc_id < b.doc_id;
+}
+
+static int64_t MtimeTicks(std::filesystem::file_time_type mtime) {
+    return static_cast<int64_t>(mtime.time_since_epoch().count());
+}
+
+namespace {
+
+// Live postings of one term of a merge input, decoded a block at a time
+// together with their positions
+class MergeCursor {
+public:
+    MergeCursor(const InvertedIndex::LiveSegment& input, uint32_t term_id, bool positions)
+        : input(&input),
+          postings(input.segment->Postings(term_id)),
+          term_positions(positions ? input.segment->Positions(term_id) : PositionList()),
+          positions(positions) {}
+
+    // Moves to the next live posting; false after the last
+    bool Next() {
+        while (true) {
+            if (index == block_size) {
+                if (block == postings.BlockCount()) return false;
+                block_size = postings.BlockSize(block);
+                postings.DecodeBlock(block, doc_ids, tfs);
+                if (positions) {
+                    block_positions.clear();
+                    term_positions.DecodeBlock(block, tfs, block_size, block_positions);
+                }
+                ++block;
+                index = 0;
+                next_position = 0;
+            }
+
+            size_t i = index++;
+            current_position = next_position;
+            next_position += tfs[i];
+            if (!input->IsDeleted(doc_ids[i])) {
+                current = {doc_ids[i], tfs[i]};
+                return true;
+            }
+        }
+    }
+
+    const Posting& Current() const { return current; }
+    // Positions of the current posting; null without positions
+    const uint32_t* Positions() const { return positions ? block_positions.data() + current_position : nullptr; }
+
+private:
+    const InvertedIndex::LiveSegment* input;
+    PostingList postings;
+    PositionList term_positions;
+    bool positions;
+    size_t block = 0;
+    size_t block_size = 0;
+    size_t index = 0;
+    uint32_t doc_ids[PostingList::kBlockSize];
+    uint32_t tfs[PostingList::kBlockSize];
+    std::vector<uint32_t> block_positions;
+    size_t current_position = 0;
+    size_t next_position = 0;
+    Posting current{};
+};
+
+} // namespace
+
+InvertedIndex::InvertedIndex(size_t thread_count, const TieredMergePolicy::Options& merge_options)
+    : thread_count(thread_count), merge_policy(merge_options) {}
+
+InvertedIndex::~InvertedIndex() {
+    {
+        std::lock_guard<std::mutex> lock(merge_mutex);
+        stopping = true;
+    }
+    merge_cv.notify_all();
+    if (merge_thread.joinable()) merge_thread.join();
+}
+
 void InvertedIndex::UpdateDocumentBase() {
+    if (ApplyUpdate()) ScheduleMerges();
+}
+
+bool InvertedIndex::ApplyUpdate() {
+    std::lock_guard<std::mutex> lock(dict_mutex);
+
+    std::vector<std::string> files_paths = converter.GetTextDocuments();
+
+    ThreadPool& workers = Pool();
+    size_t partitions = workers.Size() * kPartitionsPerWorker;
+    size_t batch_size = std::max<size_t>(1, files_paths.size() / (workers.Size() * kBatchesPerWorker));
+    size_t batches = (files_paths.size() + batch_size - 1) / batch_size;
+
+    // Documents that dropped off the end of the list are deleted.
+    std::vector<uint32_t> deleted;
+    for (size_t doc_id = files_paths.size(); doc_id < documents.size(); ++doc_id) {
+        if (documents[doc_id].exists) deleted.push_back(static_cast<uint32_t>(doc_id));
+    }
+    documents.resize(files_paths.size());
+
+    // With a memory budget every worker may hold its share of it; beyond
+    // that, and whenever a batch is done, postings go to sorted runs.
+    size_t memory_budget = converter.GetIndexMemoryBudget();
+    size_t batch_budget = std::max<size_t>(1, memory_budget / workers.Size());
+    std::string spill_parent = converter.GetIndexSpillDirectory();
+    {
+        std::lock_guard<std::mutex> lock(merge_mutex);
+        spill_directory = spill_parent;
+    }
+    std::unique_ptr<TempDirectory> spill_dir;
+    if (memory_budget > 0) spill_dir = std::make_unique<TempDirectory>(spill_parent);
+    bool positions = converter.GetIndexPositions();
+    posting_cache.SetCapacity(converter.GetPostingCacheBudget());
+
+    // Diff and tokenize phase: every batch fills its own local index, no
+    // locking. Documents whose size and mtime did not change are skipped.
+    std::vector<LocalIndex> local_indexes(batches, LocalIndex(partitions, positions));
+    workers.ParallelFor(files_paths.size(), batch_size, [&](size_t begin, size_t end) {
+        auto& local_index = local_indexes[begin / batch_size];
+        auto spill = [&] {
+            SpillRun(local_index, spill_dir->File(
+                "run-" + std::to_string(begin) + "-" + std::to_string(local_index.runs.size())));
+        };
+
+        for (size_t doc_id = begin; doc_id < end; ++doc_id) {
+            if (documents[doc_id].SameFileState(DocumentInfo::Read(files_paths[doc_id]))) continue;
+            RereadDocument(files_paths[doc_id], doc_id, local_index);
+            if (spill_dir && local_index.bytes > batch_budget) spill();
+        }
+        if (spill_dir && local_index.bytes > 0) spill();
+    });
+
+    bool any_added = false;
+    for (const auto& local_index : local_indexes) {
+        deleted.insert(deleted.end(), local_index.changed.begin(), local_index.changed.end());
+        any_added = any_added || !local_index.processed.empty();
+    }
+    if (deleted.empty() && !any_added && generation != 0) return false;
+    std::sort(deleted.begin(), deleted.end());
+
+    // Previous versions are only marked deleted; their postings stay in the
+    // old segments until a merge drops them.
+    std::vector<LiveSegment> updated = DeleteDocuments(deleted);
+    std::shared_ptr<const Segment> segment = BuildSegment(local_indexes, spill_dir.get(), positions);
+    updated.push_back({segment, std::make_shared<std::vector<bool>>(), 0});
+    Publish(std::move(updated), true);
+    return true;
+}
+
+bool InvertedIndex::DeleteDocument(size_t doc_id) {
+    size_t deleted = 0;
+    {
+        std::lock_guard<std::mutex> lock(dict_mutex);
+        std::vector<LiveSegment> updated = DeleteDocuments({static_cast<uint32_t>(doc_id)}, &deleted);
+        if (deleted == 0) return false;
+
+        // Kept with the fingerprint so a saved index remembers it too.
+        if (doc_id < documents.size()) documents[doc_id].deleted = true;
+        Publish(std::move(updated), true);
+    }
+    // Enough deletions make a segment eligible for purging.
+    ScheduleMerges();
+    return true;
+}
+
+void InvertedIndex::UpdateDocument(size_t doc_id, const std::string& path) {
     {
         std::lock_guard<std::mutex> lock(dict_mutex);
-        freq_dictionary.clear();
+        if (documents.size() <= doc_id) documents.resize(doc_id + 1);
+
+        // Forget the fingerprint so even a deleted document with unchanged
+        // content is indexed again.
+        documents[doc_id] = DocumentInfo();
+        bool positions = converter.GetIndexPositions();
+        LocalIndex local_index(1, positions);
+        RereadDocument(path, doc_id, local_index);
+
+        std::vector<LocalIndex> local_indexes;
+        local_indexes.push_back(std::move(local_index));
+        std::vector<LiveSegment> updated = DeleteDocuments({static_cast<uint32_t>(doc_id)});
+        updated.push_back({BuildSegment(local_indexes, nullptr, positions),
+                           std::make_shared<std::vector<bool>>(), 0});
+        Publish(std::move(updated), true);
+    }
+    ScheduleMerges();
+}
+
+void InvertedIndex::Publish(std::vector<LiveSegment> updated, bool new_generation) {
+    auto next = std::make_shared<Snapshot>();
+    next->segments = std::move(updated);
+    // Segments without a live document are dropped right away.
+    next->segments.erase(std::remove_if(next->segments.begin(), next->segments.end(), [](const LiveSegment& live) {
+        return live.deleted_count == live.segment->DocumentCount();
+    }), next->segments.end());
+
+    next->generation = new_generation ? generation + 1 : generation.load();
+    std::atomic_store(&snapshot, std::shared_ptr<const Snapshot>(std::move(next)));
+    if (new_generation) ++generation;
+}
+
+bool InvertedIndex::RereadDocument(const std::string& files_path, const size_t doc_id, LocalIndex& local_index) {
+    DocumentInfo& info = documents[doc_id];
+    DocumentInfo current = DocumentInfo::Read(files_path);
+
+    MappedFile file;
+    if (current.exists) {
+        file = MappedFile(files_path);
+        current.exists = file.IsOpen();
+    }
+    if (current.exists) {
+        current.content_hash = HashContent(file.Data());
+    }
+
+    // Postings only depend on the content: a touched but unmodified file
+    // keeps them and just gets a fresh fingerprint.
+    bool same_content = current.exists == info.exists && current.content_hash == info.content_hash;
+    bool had_postings = info.exists && !info.deleted;
+    if (same_content) current.deleted = info.deleted;
+    info = std::move(current);
+    if (same_content) return false;
+
+    if (had_postings) local_index.changed.push_back(static_cast<uint32_t>(doc_id));
+    if (info.exists) {
+        ProcessFile(file.Data(), doc_id, local_index);
+    }
+    return true;
+}
+
+std::vector<InvertedIndex::LiveSegment> InvertedIndex::DeleteDocuments(const std::vector<uint32_t>& doc_ids,
+                                                                       size_t* deleted_count) const {
+    std::vector<LiveSegment> result = GetSnapshot()->segments;
+    if (deleted_count) *deleted_count = 0;
+
+    for (auto& live : result) {
+        std::shared_ptr<std::vector<bool>> deleted;
+        for (uint32_t doc_id : doc_ids) {
+            if (live.IsDeleted(doc_id) || !live.segment->ContainsDocument(doc_id)) continue;
+
+            // Readers may hold the current set; change a copy.
+            if (!deleted) deleted = std::make_shared<std::vector<bool>>(*live.deleted);
+            if (deleted->size() <= doc_id) deleted->resize(doc_id + 1);
+            (*deleted)[doc_id] = true;
+            ++live.deleted_count;
+            if (deleted_count) ++*deleted_count;
+        }
+        if (deleted) live.deleted = std::move(deleted);
+    }
+    return result;
+}
+
+std::shared_ptr<const Segment> InvertedIndex::BuildSegment(std::vector<LocalIndex>& local_indexes,
+                                                           const TempDirectory* spill_dir, bool positions) {
+    if (spill_dir) {
+        std::vector<std::string> runs;
+        for (const auto& local_index : local_indexes) {
+            runs.insert(runs.end(), local_index.runs.begin(), local_index.runs.end());
+        }
+
+        // The segment file is unlinked with spill_dir; the mapping keeps
+        // its pages alive.
+        SegmentWriter writer(spill_dir->File("segment"), positions);
+        RunMerger merger(runs);
+        Posting posting;
+        std::vector<uint32_t> posting_positions;
+        // Posting by posting: a common term never has to fit the budget.
+        while (merger.NextTerm()) {
+            writer.BeginTerm(merger.Term());
+            while (merger.NextPosting(posting, posting_positions)) {
+                writer.AddPosting(posting, positions ? posting_positions.data() : nullptr);
+            }
+            writer.EndTerm();
+        }
+        AddDocuments(local_indexes, writer);
+        return writer.Finish();
+    }
+
+    ThreadPool& workers = Pool();
+    size_t partitions = local_indexes.empty() ? 1 : local_indexes.front().dictionary.size();
+
+    // Each task owns one hash partition: it merges that partition of every
+    // batch and encodes the lists, no locking needed.
+    std::vector<std::vector<EncodedTerm>> encoded(partitions);
+    workers.ParallelFor(partitions, 1, [&](size_t begin, size_t end) {
+        for (size_t partition = begin; partition < end; ++partition) {
+            MergePartition(partition, local_indexes, encoded[partition]);
+        }
+    });
+
+    // Segments keep their terms in byte order.
+    std::vector<const EncodedTerm*> order;
+    for (const auto& terms : encoded) {
+        for (const auto& term : terms) order.push_back(&term);
+    }
+    std::sort(order.begin(), order.end(),
+        [](const EncodedTerm* a, const EncodedTerm* b) { return a->term < b->term; });
+
+    SegmentWriter writer(positions);
+    for (const EncodedTerm* term : order) {
+        writer.AddTerm(term->term, term->postings, term->positions);
+    }
+    AddDocuments(local_indexes, writer);
+    return writer.Finish();
+}
+
+void InvertedIndex::SpillRun(LocalIndex& local_index, const std::string& path) const {
+    std::vector<std::pair<const std::string*, const Postings*>> entries;
+    for (const auto& dictionary : local_index.dictionary) {
+        for (const auto& [word, postings] : dictionary) {
+            entries.emplace_back(&word, &postings);
+        }
+    }
+    std::sort(entries.begin(), entries.end(),
+        [](const auto& a, const auto& b) { return *a.first < *b.first; });
+
+    RunWriter run(path);
+    for (const auto& [word, postings] : entries) {
+        run.Add(*word, postings->postings, postings->positions);
+    }
+    run.Finish();
+
+    local_index.runs.push_back(path);
+    local_index.dictionary.assign(local_index.dictionary.size(), Dictionary());
+    local_index.bytes = 0;
+}
+
+void InvertedIndex::AddDocuments(const std::vector<LocalIndex>& local_indexes, SegmentWriter& writer) const {
+    std::vector<uint32_t> processed;
+    for (const auto& local_index : local_indexes) {
+        processed.insert(processed.end(), local_index.processed.begin(), local_index.processed.end());
+    }
+    std::sort(processed.begin(), processed.end());
+    for (uint32_t doc_id : processed) {
+        const DocumentInfo& info = documents[doc_id];
+        writer.AddDocument(doc_id, info.exists, info.path, info.size, MtimeTicks(info.mtime), info.content_hash);
+    }
+}
+
+void InvertedIndex::MergePartition(size_t partition, std::vector<LocalIndex>& local_indexes,
+                                   std::vector<EncodedTerm>& encoded) {
+    // Batches come in doc_id order, so appending keeps every list sorted.
+    Dictionary merged;
+    for (auto& local_index : local_indexes) {
+        Dictionary& source = local_index.dictionary[partition];
+        if (merged.empty()) {
+            merged = std::move(source);
+            source = Dictionary();
+            continue;
+        }
+
+        for (auto it = source.begin(); it != source.end();) {
+            auto found = merged.find(it->first);
+            if (found == merged.end()) {
+                // New term: move its node over, key and all
+                merged.insert(source.extract(it++));
+                continue;
+            }
+            Postings& target = found->second;
+            target.postings.insert(target.postings.end(), it->second.postings.begin(), it->second.postings.end());
+            target.positions.insert(target.positions.end(), it->second.positions.begin(), it->second.positions.end());
+            ++it;
+        }
+        source = Dictionary();
+    }
+
+    encoded.reserve(merged.size());
+    while (!merged.empty()) {
+        auto node = merged.extract(merged.begin());
+        const Postings& postings = node.mapped();
+        encoded.push_back({std::move(node.key()), PostingList(postings.postings),
+                           postings.positions.empty() ? PositionList()
+                                                      : PositionList(postings.postings, postings.positions)});
+    }
+}
+
+bool InvertedIndex::HavePositions(const std::vector<LiveSegment>& segments) {
+    return std::all_of(segments.begin(), segments.end(),
+        [](const LiveSegment& live) { return live.segment->HasPositions(); });
+}
+
+bool InvertedIndex::MergeSegments(const std::vector<LiveSegment>& inputs, SegmentWriter& writer,
+                                  const std::function<bool(size_t)>& pace) {
+    // Term tables are sorted, so the inputs are merged like sorted runs;
+    // the postings of a term are streamed from its inputs in doc_id order.
+    std::vector<uint32_t> cursors(inputs.size(), 0);
+    bool positions = HavePositions(inputs);
+    std::vector<MergeCursor> sources;
+    sources.reserve(inputs.size());
+    // Min-heap of sources by the doc_id of their current posting
+    std::vector<size_t> heap;
+    auto after = [&](size_t a, size_t b) { return sources[a].Current().doc_id > sources[b].Current().doc_id; };
+
+    while (true) {
+        std::string_view term;
+        bool found = false;
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            if (cursors[i] == inputs[i].segment->TermCount()) continue;
+            std::string_view candidate = inputs[i].segment->Term(cursors[i]);
+            if (!found || candidate < term) {
+                term = candidate;
+                found = true;
+            }
+        }
+        if (!found) return true;
+
+        sources.clear();
+        heap.clear();
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            const LiveSegment& input = inputs[i];
+            if (cursors[i] == input.segment->TermCount() || input.segment->Term(cursors[i]) != term) continue;
+
+            sources.emplace_back(input, cursors[i], positions);
+            if (sources.back().Next()) heap.push_back(sources.size() - 1);
+            ++cursors[i];
+        }
+        std::make_heap(heap.begin(), heap.end(), after);
+
+        // A live document is in one input only, so no doc_id repeats.
+        writer.BeginTerm(term);
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), after);
+            MergeCursor& source = sources[heap.back()];
+            writer.AddPosting(source.Current(), source.Positions());
+            if (source.Next()) {
+                std::push_heap(heap.begin(), heap.end(), after);
+            } else {
+                heap.pop_back();
+            }
+        }
+        size_t bytes = writer.EndTerm();
+        if (bytes > 0 && !pace(bytes)) return false;
+    }
+}
+
+bool InvertedIndex::MergeOnce() {
+    std::vector<LiveSegment> current = GetSnapshot()->segments;
+
+    // Deleted documents do not count towards a segment's size.
+    std::vector<TieredMergePolicy::SegmentInfo> stats;
+    for (const auto& live : current) {
+        size_t docs = live.segment->DocumentCount();
+        double live_fraction = static_cast<double>(docs - live.deleted_count) / static_cast<double>(docs);
+        stats.push_back({static_cast<size_t>(static_cast<double>(live.segment->ByteSize()) * live_fraction),
+                         docs, live.deleted_count});
+    }
+
+    std::vector<size_t> chosen = merge_policy.FindMerge(stats);
+    if (chosen.empty()) return false;
+
+    std::vector<LiveSegment> inputs;
+    for (size_t i : chosen) inputs.push_back(current[i]);
+
+    // Only background merges are throttled; inline ones hold up the update
+    // that triggered them anyway.
+    const auto& options = merge_policy.GetOptions();
+    MergeRateLimiter limiter(options.background ? options.max_merge_bytes_per_second : 0);
+    auto pace = [&](size_t bytes) {
+        auto pause = limiter.Account(bytes);
+        if (pause > std::chrono::steady_clock::duration::zero()) {
+            std::unique_lock<std::mutex> lock(merge_mutex);
+            merge_cv.wait_for(lock, pause, [&] { return stopping.load(); });
+        }
+        return !stopping;
+    };
+
+    // The merged segment goes to a mapped file, so neither the merge nor
+    // the result holds the inputs' postings in memory. The file is
+    // unlinked with merge_dir; the mapping keeps its pages alive.
+    std::string spill_parent;
+    {
+        std::lock_guard<std::mutex> lock(merge_mutex);
+        spill_parent = spill_directory;
+    }
+    TempDirectory merge_dir(spill_parent);
+    SegmentWriter writer(merge_dir.File("segment"), HavePositions(inputs));
+    if (!MergeSegments(inputs, writer, pace)) return false;
+
+    std::vector<Segment::DocumentEntry> entries;
+    for (const auto& input : inputs) {
+        for (size_t i = 0; i < input.segment->DocumentCount(); ++i) {
+            Segment::DocumentEntry entry = input.segment->Document(i);
+            if (!input.IsDeleted(entry.doc_id)) entries.push_back(entry);
+        }
+    }
+    std::sort(entries.begin(), entries.end(),
+        [](const auto& a, const auto& b) { return a.doc_id < b.doc_id; });
+    for (const auto& entry : entries) {
+        writer.AddDocument(entry.doc_id, entry.exists, entry.path, entry.size, entry.mtime, entry.content_hash,
+                           entry.deleted);
+    }
+    std::shared_ptr<const Segment> merged = writer.Finish();
+
+    // Commit: swap the inputs for the merged segment, carrying over
+    // documents deleted from the inputs while the merge ran.
+    std::lock_guard<std::mutex> lock(dict_mutex);
+
+    auto deleted = std::make_shared<std::vector<bool>>();
+    size_t deleted_count = 0;
+    size_t replaced = 0;
+    std::vector<LiveSegment> published;
+    auto latest = GetSnapshot();
+    for (const auto& live : latest->segments) {
+        auto input = std::find_if(inputs.begin(), inputs.end(),
+            [&](const LiveSegment& candidate) { return candidate.segment == live.segment; });
+        if (input == inputs.end()) {
+            published.push_back(live);
+            continue;
+        }
+
+        ++replaced;
+        if (live.deleted == input->deleted) continue;
+        for (uint32_t doc_id = 0; doc_id < live.deleted->size(); ++doc_id) {
+            if (!(*live.deleted)[doc_id] || input->IsDeleted(doc_id)) continue;
+            if (deleted->size() <= doc_id) deleted->resize(doc_id + 1);
+            (*deleted)[doc_id] = true;
+            ++deleted_count;
+        }
+    }
+
+    // A load replaced the segments meanwhile; the merge is moot.
+    if (replaced != inputs.size()) return true;
+
+    published.push_back({merged, std::move(deleted), deleted_count});
+    Publish(std::move(published), false);
+    return true;
+}
+
+void InvertedIndex::ScheduleMerges() {
+    if (!merge_policy.GetOptions().background) {
+        while (MergeOnce()) {}
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(merge_mutex);
+    if (!merge_thread.joinable()) merge_thread = std::thread(&InvertedIndex::MergeLoop, this);
+    merge_requested = true;
+    merge_cv.notify_all();
+}
+
+void InvertedIndex::MergeLoop() {
+    std::unique_lock<std::mutex> lock(merge_mutex);
+    while (true) {
+        merge_cv.wait(lock, [&] { return merge_requested || stopping; });
+        if (stopping) break;
+
+        merge_requested = false;
+        merging = true;
+        lock.unlock();
+        try {
+            while (!stopping && MergeOnce()) {}
+        } catch (const std::exception& e) {
+            std::cerr << "Segment merge failed: " << e.what() << std::endl;
+        }
+        lock.lock();
+        merging = false;
+        merge_idle_cv.notify_all();
     }
+    merge_idle_cv.notify_all();
+}
+
+void InvertedIndex::WaitForMerges() {
+    std::unique_lock<std::mutex> lock(merge_mutex);
+    merge_idle_cv.wait(lock, [&] { return (!merge_requested && !merging) || stopping; });
+}
 
-    std::vector<std::string> files_paths;
-    std::vector<std::thread> threads;
+std::shared_ptr<const InvertedIndex::Snapshot> InvertedIndex::GetSnapshot() const {
+    return std::atomic_load(&snapshot);
+}
 
-    files_paths = converter.GetTextDocuments();
+void InvertedIndex::Save(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(dict_mutex);
+
+    auto current = GetSnapshot();
+    SegmentWriter writer(path, HavePositions(current->segments));
+    MergeSegments(current->segments, writer, [](size_t) { return true; });
+    for (size_t doc_id = 0; doc_id < documents.size(); ++doc_id) {
+        const DocumentInfo& info = documents[doc_id];
+        writer.AddDocument(static_cast<uint32_t>(doc_id), info.exists, info.path, info.size,
+                           MtimeTicks(info.mtime), info.content_hash, info.deleted);
+    }
+    writer.Finish();
+}
+
+void InvertedIndex::Load(const std::string& path, bool verify_checksum) {
+    std::shared_ptr<const Segment> loaded = Segment::Open(path, verify_checksum);
+
+    std::vector<DocumentInfo> infos(loaded->DocumentCount());
+    // Deleted and missing documents have no postings; marking them deleted
+    // keeps them from counting as live versions.
+    auto deleted = std::make_shared<std::vector<bool>>();
+    size_t deleted_count = 0;
+    for (size_t i = 0; i < infos.size(); ++i) {
+        Segment::DocumentEntry entry = loaded->Document(i);
+        if (entry.doc_id >= infos.size()) {
+            throw std::runtime_error("index segment " + path + ": document id out of range");
+        }
+
+        DocumentInfo& info = infos[entry.doc_id];
+        info.path = entry.path;
+        info.exists = entry.exists;
+        info.deleted = entry.deleted;
+        info.size = entry.size;
+        info.mtime = std::filesystem::file_time_type(std::filesystem::file_time_type::duration(entry.mtime));
+        info.content_hash = entry.content_hash;
+
+        if (entry.deleted || !entry.exists) {
+            if (deleted->size() <= entry.doc_id) deleted->resize(entry.doc_id + 1);
+            (*deleted)[entry.doc_id] = true;
+            ++deleted_count;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(dict_mutex);
+    documents = std::move(infos);
+    Publish({{std::move(loaded), std::move(deleted), deleted_count}}, true);
+}
+
+bool InvertedIndex::Refresh() {
+    if (!IsStale()) return false;
+
+    UpdateDocumentBase();
+    return true;
+}
+
+bool InvertedIndex::IsStale() const {
+    std::lock_guard<std::mutex> lock(dict_mutex);
+
+    if (generation == 0) return true;
+
+    std::vector<std::string> files_paths = converter.GetTextDocuments();
+    if (files_paths.size() != documents.size()) return true;
 
     for (size_t doc_id = 0; doc_id < files_paths.size(); ++doc_id) {
-        threads.emplace_back(
-            &InvertedIndex::ProcessFile, this,
-            std::cref(files_paths[doc_id]), doc_id
-        );
+        if (!documents[doc_id].SameFileState(DocumentInfo::Read(files_paths[doc_id]))) return true;
     }
+    return false;
+}
 
-    for (auto& thread : threads) {
-        if (thread.joinable()) thread.join();
+InvertedIndex::DocumentInfo InvertedIndex::DocumentInfo::Read(const std::string& path) {
+    DocumentInfo info;
+    info.path = path;
+
+    std::error_code ec;
+    std::filesystem::file_status status = std::filesystem::status(path, ec);
+    if (ec || !std::filesystem::exists(status) || std::filesystem::is_directory(status)) return info;
+
+    info.exists = true;
+    // Pipes and devices have no meaningful size or mtime; they are read
+    // through MappedFile's buffered fallback on every update instead.
+    if (!std::filesystem::is_regular_file(status)) {
+        info.special = true;
+        return info;
     }
+
+    info.size = std::filesystem::file_size(path, ec);
+    if (!ec) info.mtime = std::filesystem::last_write_time(path, ec);
+    if (ec) info.exists = false;
+    return info;
 }
 
-void InvertedIndex::ProcessFile(const std::string& files_path, const size_t doc_id) {
-    std::ifstream file(files_path);
-    if (!file.is_open()) return;
+bool InvertedIndex::DocumentInfo::SameFileState(const DocumentInfo& other) const {
+    if (path != other.path || exists != other.exists) return false;
+    if (special || other.special) return false;
+    return !exists || (size == other.size && mtime == other.mtime);
+}
 
-    std::string word;
-    while (file >> word) {
-        std::lock_guard<std::mutex> lock(dict_mutex);
-        freq_dictionary[word][doc_id]++;
+ThreadPool& InvertedIndex::Pool() {
+    if (!pool) pool = std::make_unique<ThreadPool>(thread_count);
+    return *pool;
+}
+
+void InvertedIndex::ProcessFile(std::string_view content, const size_t doc_id, LocalIndex& local_index) const {
+    // Keys point into the tokenizer's buffer; strings are only created once
+    // per distinct term when the counts go into the local dictionary.
+    struct Occurrences {
+        uint32_t count = 0;
+        std::vector<uint32_t> positions;
+    };
+    std::unordered_map<std::string_view, Occurrences> occurrences;
+    Tokenizer tokenizer(content);
+
+    // A token's position is its ordinal in the document.
+    std::string_view word;
+    for (uint32_t position = 0; tokenizer.Next(word); ++position) {
+        Occurrences& entry = occurrences[word];
+        ++entry.count;
+        if (local_index.positions) entry.positions.push_back(position);
+    }
+
+    size_t partitions = local_index.dictionary.size();
+    for (auto& [word, occurrence] : occurrences) {
+        size_t partition = std::hash<std::string_view>{}(word) % partitions;
+        auto [entry, inserted] = local_index.dictionary[partition].try_emplace(std::string(word));
+        Postings& postings = entry->second;
+        postings.postings.push_back({static_cast<uint32_t>(doc_id), occurrence.count});
+        postings.positions.insert(postings.positions.end(), occurrence.positions.begin(), occurrence.positions.end());
+
+        local_index.bytes += sizeof(Posting) + occurrence.positions.size() * sizeof(uint32_t) +
+                             (inserted ? word.size() + kTermOverheadBytes : 0);
+    }
+    local_index.processed.push_back(static_cast<uint32_t>(doc_id));
+}
+
+PostingList InvertedIndex::TermPostings(const LiveSegment& segment, uint32_t term_id) const {
+    return posting_cache.Postings(segment.segment, term_id);
+}
+
+InvertedIndex::Snapshot::Snapshot() : absent_terms(kAbsentTermsBytes) {}
+
+bool InvertedIndex::Snapshot::HasTerm(const std::string& word) const {
+    if (absent_terms.Find(word, [](bool) { return true; })) return false;
+
+    for (const auto& live : segments) {
+        if (live.segment->FindTerm(word) != Segment::kNoTerm) return true;
     }
-    file.close();
+    absent_terms.Put(word, true, kAbsentTermBytes + 2 * word.size(), [](bool) { return true; });
+    return false;
 }
 
-const std::unordered_map<size_t, size_t>& InvertedIndex::GetWordCount(const std::string& word) const {
-    static const std::unordered_map<size_t, size_t> empty_result;
+PostingList InvertedIndex::GetWordCount(const std::string& word) const {
+    std::vector<Posting> postings;
+    auto current = GetSnapshot();
+    if (!current->HasTerm(word)) return PostingList();
 
-    auto it = freq_dictionary.find(word);
-    return (it != freq_dictionary.end()) ? it->second : empty_result;
+    for (const auto& live : current->segments) {
+        uint32_t term_id = live.segment->FindTerm(word);
+        if (term_id == Segment::kNoTerm) continue;
+
+        for (const Posting& posting : TermPostings(live, term_id)) {
+            if (!live.IsDeleted(posting.doc_id)) postings.push_back(posting);
+        }
+    }
+    std::sort(postings.begin(), postings.end(), ByDocId);
+    return PostingList(postings);
 }
@@ -0,0 +1,111 @@
+#include "MappedFile.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <utility>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static constexpr size_t kReadChunk = 64 * 1024;
+
+MappedFile::MappedFile(const std::string& path, Access access) {
+#ifdef _WIN32
+    int fd = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+    if (fd < 0) return;
+
+    struct stat st {};
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        is_open = Map(fd, static_cast<size_t>(st.st_size), access) || ReadAll(fd);
+    } else {
+        is_open = ReadAll(fd);
+    }
+
+#ifdef _WIN32
+    _close(fd);
+#else
+    close(fd);
+#endif
+}
+
+MappedFile::~MappedFile() {
+    Release();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        Release();
+        is_open = std::exchange(other.is_open, false);
+        mapping = std::exchange(other.mapping, nullptr);
+        mapping_size = std::exchange(other.mapping_size, 0);
+        buffer = std::move(other.buffer);
+    }
+    return *this;
+}
+
+std::string_view MappedFile::Data() const {
+    if (mapping) return {static_cast<const char*>(mapping), mapping_size};
+    return buffer;
+}
+
+bool MappedFile::Map(int fd, size_t size, Access access) {
+#ifdef _WIN32
+    (void)fd;
+    (void)size;
+    (void)access;
+    return false;
+#else
+    void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) return false;
+
+    // Documents are tokenized front to back exactly once; index segments
+    // are probed term by term.
+    madvise(address, size, access == Access::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+
+    mapping = address;
+    mapping_size = size;
+    return true;
+#endif
+}
+
+bool MappedFile::ReadAll(int fd) {
+    buffer.clear();
+
+    char chunk[kReadChunk];
+    while (true) {
+#ifdef _WIN32
+        auto bytes = _read(fd, chunk, static_cast<unsigned>(sizeof(chunk)));
+#else
+        auto bytes = read(fd, chunk, sizeof(chunk));
+#endif
+        if (bytes == 0) return true;
+        if (bytes < 0) {
+            if (errno == EINTR) continue;
+            buffer.clear();
+            return false;
+        }
+        buffer.append(chunk, static_cast<size_t>(bytes));
+    }
+}
+
+void MappedFile::Release() {
+#ifndef _WIN32
+    if (mapping) munmap(mapping, mapping_size);
+#endif
+    mapping = nullptr;
+    mapping_size = 0;
+    buffer.clear();
+    is_open = false;
+}
@@ -0,0 +1,63 @@
+#include "MergePolicy.h"
+
+#include <algorithm>
+#include <numeric>
+
+size_t TieredMergePolicy::TierOf(size_t bytes) const {
+    size_t tier = 0;
+    size_t limit = std::max<size_t>(options.floor_segment_bytes, 1);
+    while (bytes > limit) {
+        limit *= std::max<size_t>(options.segments_per_tier, 2);
+        ++tier;
+    }
+    return tier;
+}
+
+std::vector<size_t> TieredMergePolicy::FindMerge(const std::vector<SegmentInfo>& segments) const {
+    size_t merge_width = std::max<size_t>(options.segments_per_tier, 2);
+
+    std::vector<size_t> order(segments.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+        [&](size_t a, size_t b) { return segments[a].live_bytes < segments[b].live_bytes; });
+
+    // Walk the tiers smallest first; order keeps each tier contiguous.
+    for (size_t begin = 0; begin < order.size();) {
+        size_t tier = TierOf(segments[order[begin]].live_bytes);
+        size_t end = begin;
+        while (end < order.size() && TierOf(segments[order[end]].live_bytes) == tier) ++end;
+
+        if (end - begin >= merge_width) {
+            std::vector<size_t> merge(order.begin() + begin, order.begin() + begin + merge_width);
+            std::sort(merge.begin(), merge.end());
+            return merge;
+        }
+        begin = end;
+    }
+
+    size_t purge = segments.size();
+    double purge_fraction = options.max_deleted_fraction;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        if (segments[i].documents == 0) continue;
+        double fraction = static_cast<double>(segments[i].deleted) / static_cast<double>(segments[i].documents);
+        if (fraction > purge_fraction) {
+            purge = i;
+            purge_fraction = fraction;
+        }
+    }
+    if (purge < segments.size()) return {purge};
+    return {};
+}
+
+MergeRateLimiter::MergeRateLimiter(double bytes_per_second)
+    : bytes_per_second(bytes_per_second), start(std::chrono::steady_clock::now()) {}
+
+std::chrono::steady_clock::duration MergeRateLimiter::Account(size_t bytes) {
+    if (bytes_per_second <= 0) return {};
+
+    written += static_cast<double>(bytes);
+    auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(written / bytes_per_second));
+    auto now = std::chrono::steady_clock::now();
+    return due > now ? due - now : std::chrono::steady_clock::duration::zero();
+}
@@ -0,0 +1,220 @@
+#include "PositionList.h"
+#include "PostingCodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+static constexpr size_t kHeaderBytes = 4;
+
+static size_t WriteVarint(uint32_t value, uint8_t* out) {
+    size_t written = 0;
+    while (value >= 0x80) {
+        out[written++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    out[written++] = static_cast<uint8_t>(value);
+    return written;
+}
+
+// nullptr if the varint is longer than five bytes or runs past end
+static const uint8_t* ReadVarint(const uint8_t* in, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 35 && in < end; shift += 7) {
+        uint8_t byte = *in++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (byte < 0x80) return in;
+    }
+    return nullptr;
+}
+
+// Reads the size prefix of a posting's positions; returns their start.
+// Every position takes at least one byte, which also bounds tf.
+static const uint8_t* ReadPositionsSize(const uint8_t* in, const uint8_t* end, uint32_t tf, uint32_t& size) {
+    in = ReadVarint(in, end, size);
+    if (in == nullptr || size > static_cast<size_t>(end - in) || tf > size) {
+        throw std::runtime_error("PositionList: corrupt positions");
+    }
+    return in;
+}
+
+PositionList PositionList::View(const uint8_t* bytes, size_t size) {
+    PositionList list;
+    if (size > 0) {
+        list.bytes = bytes;
+        list.byte_size = size;
+    }
+    return list;
+}
+
+PositionList::PositionList(const PositionList& other) {
+    *this = other;
+}
+
+PositionList& PositionList::operator=(const PositionList& other) {
+    if (this == &other) return *this;
+
+    owned = other.owned;
+    byte_size = other.byte_size;
+    bytes = other.owned.empty() ? other.bytes : owned.data();
+    return *this;
+}
+
+PositionList::PositionList(PositionList&& other) noexcept {
+    *this = std::move(other);
+}
+
+PositionList& PositionList::operator=(PositionList&& other) noexcept {
+    if (this == &other) return *this;
+
+    owned = std::move(other.owned);
+    bytes = std::exchange(other.bytes, nullptr);
+    byte_size = std::exchange(other.byte_size, 0);
+    other.owned.clear();
+    return *this;
+}
+
+PositionList::PositionList(const std::vector<Posting>& postings, const std::vector<uint32_t>& positions) {
+    if (postings.empty()) return;
+
+    std::vector<uint8_t> payload;
+    PositionListEncoder encoder([&](const uint8_t* data, size_t size) {
+        payload.insert(payload.end(), data, data + size);
+    });
+    const uint32_t* next = positions.data();
+    for (const Posting& posting : postings) {
+        encoder.Add(next, posting.tf);
+        next += posting.tf;
+    }
+
+    owned = encoder.Finish();
+    owned.insert(owned.end(), payload.begin(), payload.end());
+    owned.shrink_to_fit();
+    bytes = owned.data();
+    byte_size = owned.size();
+}
+
+const uint8_t* PositionList::BlockBegin(size_t block) const {
+    uint32_t offset;
+    std::memcpy(&offset, bytes + kHeaderBytes + block * 4, sizeof(offset));
+    return bytes + offset;
+}
+
+void PositionList::Decode(size_t index, uint32_t tf, std::vector<uint32_t>& out) const {
+    const uint8_t* end = bytes + byte_size;
+    const uint8_t* in = BlockBegin(index / PostingList::kBlockSize);
+    uint32_t size;
+    for (size_t skipped = index % PostingList::kBlockSize; skipped > 0; --skipped) {
+        in = ReadPositionsSize(in, end, 0, size);
+        in += size;
+    }
+    in = ReadPositionsSize(in, end, tf, size);
+
+    out.resize(tf);
+    // The list end as limit keeps the SIMD path for short postings.
+    if (DecodeStreamVByteDeltas(in, end, tf, 0, out.data()) != in + size) {
+        throw std::runtime_error("PositionList: corrupt positions");
+    }
+}
+
+void PositionList::DecodeBlock(size_t block, const uint32_t* tfs, size_t count, std::vector<uint32_t>& out) const {
+    const uint8_t* end = bytes + byte_size;
+    const uint8_t* in = BlockBegin(block);
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t size;
+        in = ReadPositionsSize(in, end, tfs[i], size);
+
+        size_t at = out.size();
+        out.resize(at + tfs[i]);
+        if (DecodeStreamVByteDeltas(in, end, tfs[i], 0, out.data() + at) != in + size) {
+            throw std::runtime_error("PositionList: corrupt positions");
+        }
+        in += size;
+    }
+}
+
+bool PositionList::VerifyHeaders(size_t block_count) const {
+    if (byte_size == 0) return block_count == 0;
+    if (byte_size < kHeaderBytes) return false;
+
+    uint32_t stored_count;
+    std::memcpy(&stored_count, bytes, sizeof(stored_count));
+    if (stored_count != block_count || block_count > (byte_size - kHeaderBytes) / 4) return false;
+    // Every block starts with the size prefix of its first posting.
+    size_t header_size = kHeaderBytes + block_count * 4;
+    for (size_t block = 0; block < block_count; ++block) {
+        uint32_t offset;
+        std::memcpy(&offset, bytes + kHeaderBytes + block * 4, sizeof(offset));
+        if (offset < header_size || offset >= byte_size) return false;
+    }
+    return true;
+}
+
+void PositionListEncoder::Add(const uint32_t* positions, uint32_t tf) {
+    if (count++ % PostingList::kBlockSize == 0) block_offsets.push_back(static_cast<uint32_t>(payload_size));
+
+    gaps.resize(tf);
+    uint32_t previous = 0;
+    for (uint32_t j = 0; j < tf; ++j) {
+        gaps[j] = positions[j] - previous;
+        previous = positions[j];
+    }
+
+    // Size prefix, then the gaps
+    encoded.resize(StreamVByteMaxBytes(tf));
+    uint8_t prefix[5];
+    size_t size = EncodeStreamVByte(gaps.data(), tf, encoded.data());
+    size_t prefix_size = WriteVarint(static_cast<uint32_t>(size), prefix);
+
+    write(prefix, prefix_size);
+    write(encoded.data(), size);
+    payload_size += prefix_size + size;
+}
+
+std::vector<uint8_t> PositionListEncoder::Finish() {
+    size_t header_size = kHeaderBytes + block_offsets.size() * 4;
+    std::vector<uint8_t> header(header_size);
+
+    uint32_t block_count = static_cast<uint32_t>(block_offsets.size());
+    std::memcpy(header.data(), &block_count, sizeof(block_count));
+    for (size_t block = 0; block < block_offsets.size(); ++block) {
+        uint32_t offset = block_offsets[block] + static_cast<uint32_t>(header_size);
+        std::memcpy(header.data() + kHeaderBytes + block * 4, &offset, sizeof(offset));
+    }
+    return header;
+}
+
+void SortByDocId(std::vector<Posting>& postings, std::vector<uint32_t>& positions) {
+    auto by_doc_id = [](const Posting& a, const Posting& b) { return a.doc_id < b.doc_id; };
+    if (positions.empty()) {
+        std::sort(postings.begin(), postings.end(), by_doc_id);
+        return;
+    }
+    if (std::is_sorted(postings.begin(), postings.end(), by_doc_id)) return;
+
+    std::vector<size_t> starts(postings.size());
+    size_t start = 0;
+    for (size_t i = 0; i < postings.size(); ++i) {
+        starts[i] = start;
+        start += postings[i].tf;
+    }
+
+    std::vector<size_t> order(postings.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(),
+        [&](size_t a, size_t b) { return postings[a].doc_id < postings[b].doc_id; });
+
+    std::vector<Posting> sorted_postings;
+    std::vector<uint32_t> sorted_positions;
+    sorted_postings.reserve(postings.size());
+    sorted_positions.reserve(positions.size());
+    for (size_t i : order) {
+        sorted_postings.push_back(postings[i]);
+        sorted_positions.insert(sorted_positions.end(), positions.begin() + starts[i],
+                                positions.begin() + starts[i] + postings[i].tf);
+    }
+    postings.swap(sorted_postings);
+    positions.swap(sorted_positions);
+}
@@ -0,0 +1,62 @@
+#include "PostingCache.h"
+
+#include <functional>
+
+// Keys remembered per shard before the admission filter starts over
+static constexpr size_t kSeenKeys = 4096;
+
+// Entry overhead besides the lists: list and hash nodes
+static constexpr size_t kEntryBytes = 96;
+
+size_t PostingCache::KeyHash::operator()(const Key& key) const {
+    return std::hash<const void*>()(key.segment) ^ (std::hash<uint32_t>()(key.term_id) * 0x9e3779b97f4a7c15ull);
+}
+
+PostingCache::PostingCache(size_t capacity_bytes, size_t shard_count)
+    : lru(capacity_bytes, shard_count) {
+    if (shard_count == 0) shard_count = 1;
+
+    seen.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) seen.push_back(std::make_unique<SeenShard>());
+}
+
+void PostingCache::SetCapacity(size_t capacity_bytes) {
+    lru.SetCapacity(capacity_bytes);
+    if (lru.Enabled()) return;
+
+    for (const auto& shard : seen) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->keys.clear();
+    }
+}
+
+bool PostingCache::ReadBefore(const Key& key) {
+    SeenShard& shard = *seen[KeyHash()(key) % seen.size()];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    if (shard.keys.erase(key) > 0) return true;
+    if (shard.keys.size() >= kSeenKeys) shard.keys.clear();
+    shard.keys.insert(key);
+    return false;
+}
+
+PostingList PostingCache::Postings(const std::shared_ptr<const Segment>& segment, uint32_t term_id) {
+    if (!lru.Enabled()) return segment->Postings(term_id);
+
+    Key key{segment.get(), term_id};
+    PostingList postings;
+    // While segment is alive, no other segment can have its address.
+    bool hit = lru.Find(key, [&](const Cached& cached) {
+        if (cached.segment.expired()) return false;
+        postings = cached.postings;
+        return true;
+    });
+    if (hit) return postings;
+    if (!ReadBefore(key)) return segment->Postings(term_id);
+
+    // Second read: decode and admit, unless another reader got there first
+    postings = segment->Postings(term_id).Decoded();
+    lru.Put(key, {segment, postings}, kEntryBytes + postings.MemoryBytes(),
+            [](const Cached&) { return true; });
+    return postings;
+}
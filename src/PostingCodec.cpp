@@ -0,0 +1,193 @@
+#include "PostingCodec.h"
+
+#include <array>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define POSTING_CODEC_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+unsigned ByteLength(uint32_t value) {
+    if (value < (1u << 8)) return 1;
+    if (value < (1u << 16)) return 2;
+    if (value < (1u << 24)) return 3;
+    return 4;
+}
+
+// Byte lengths and shuffle masks for every control byte
+struct StreamVByteTables {
+    std::array<uint8_t, 256> length{};
+    alignas(16) std::array<std::array<uint8_t, 16>, 256> shuffle{};
+
+    StreamVByteTables() {
+        for (int control = 0; control < 256; ++control) {
+            uint8_t offset = 0;
+            for (int lane = 0; lane < 4; ++lane) {
+                int bytes = ((control >> (2 * lane)) & 3) + 1;
+                for (int b = 0; b < 4; ++b) {
+                    // 0x80 makes the shuffle write a zero byte.
+                    shuffle[control][lane * 4 + b] = b < bytes ? static_cast<uint8_t>(offset + b) : 0x80;
+                }
+                offset += static_cast<uint8_t>(bytes);
+            }
+            length[control] = offset;
+        }
+    }
+};
+
+const StreamVByteTables& Tables() {
+    static const StreamVByteTables tables;
+    return tables;
+}
+
+uint32_t ReadValue(const uint8_t* in, unsigned bytes) {
+    uint32_t value = 0;
+    for (unsigned b = 0; b < bytes; ++b) {
+        value |= static_cast<uint32_t>(in[b]) << (8 * b);
+    }
+    return value;
+}
+
+#ifdef POSTING_CODEC_X86
+
+__attribute__((target("ssse3")))
+const uint8_t* DecodeDeltasSSSE3(const uint8_t* in, const uint8_t* limit, size_t count,
+                                 uint32_t base, uint32_t* out) {
+    const StreamVByteTables& tables = Tables();
+    if (static_cast<size_t>(limit - in) < (count + 3) / 4) return nullptr;
+    const uint8_t* control = in;
+    const uint8_t* data = in + (count + 3) / 4;
+
+    size_t i = 0;
+    __m128i previous = _mm_set1_epi32(static_cast<int>(base));
+    // Each step reads 16 data bytes; stay clear of limit.
+    for (; i + 4 <= count && limit - data >= 16; i += 4) {
+        uint8_t c = *control++;
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(tables.shuffle[c].data()));
+        __m128i gaps = _mm_shuffle_epi8(bytes, mask);
+
+        // Inclusive prefix sum of the four gaps plus the last decoded value
+        gaps = _mm_add_epi32(gaps, _mm_slli_si128(gaps, 4));
+        gaps = _mm_add_epi32(gaps, _mm_slli_si128(gaps, 8));
+        __m128i values = _mm_add_epi32(gaps, previous);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), values);
+
+        previous = _mm_shuffle_epi32(values, 0xFF);
+        data += tables.length[c];
+    }
+
+    uint32_t value = i > 0 ? out[i - 1] : base;
+    for (; i < count; ++i) {
+        unsigned bytes = ((control[0] >> (2 * (i % 4))) & 3) + 1;
+        if (static_cast<size_t>(limit - data) < bytes) return nullptr;
+        value += ReadValue(data, bytes);
+        out[i] = value;
+        data += bytes;
+        if (i % 4 == 3) ++control;
+    }
+    return data;
+}
+
+bool HasSSSE3() {
+    static const bool supported = __builtin_cpu_supports("ssse3");
+    return supported;
+}
+
+#endif // POSTING_CODEC_X86
+
+} // namespace
+
+size_t StreamVByteMaxBytes(size_t count) {
+    return (count + 3) / 4 + count * 4;
+}
+
+size_t EncodeStreamVByte(const uint32_t* values, size_t count, uint8_t* out) {
+    uint8_t* control = out;
+    uint8_t* data = out + (count + 3) / 4;
+    std::memset(control, 0, (count + 3) / 4);
+
+    for (size_t i = 0; i < count; ++i) {
+        unsigned bytes = ByteLength(values[i]);
+        control[i / 4] |= static_cast<uint8_t>((bytes - 1) << (2 * (i % 4)));
+        for (unsigned b = 0; b < bytes; ++b) {
+            *data++ = static_cast<uint8_t>(values[i] >> (8 * b));
+        }
+    }
+    return static_cast<size_t>(data - out);
+}
+
+const uint8_t* DecodeStreamVByteDeltas(const uint8_t* in, const uint8_t* limit, size_t count,
+                                       uint32_t base, uint32_t* out) {
+#ifdef POSTING_CODEC_X86
+    if (HasSSSE3()) return DecodeDeltasSSSE3(in, limit, count, base, out);
+#endif
+    return DecodeStreamVByteDeltasScalar(in, limit, count, base, out);
+}
+
+const uint8_t* DecodeStreamVByteDeltasScalar(const uint8_t* in, const uint8_t* limit, size_t count,
+                                             uint32_t base, uint32_t* out) {
+    if (static_cast<size_t>(limit - in) < (count + 3) / 4) return nullptr;
+    const uint8_t* control = in;
+    const uint8_t* data = in + (count + 3) / 4;
+
+    uint32_t value = base;
+    for (size_t i = 0; i < count; ++i) {
+        unsigned bytes = ((control[i / 4] >> (2 * (i % 4))) & 3) + 1;
+        if (static_cast<size_t>(limit - data) < bytes) return nullptr;
+        value += ReadValue(data, bytes);
+        out[i] = value;
+        data += bytes;
+    }
+    return data;
+}
+
+unsigned BitWidth(uint32_t value) {
+    unsigned width = 0;
+    while (value != 0) {
+        ++width;
+        value >>= 1;
+    }
+    return width;
+}
+
+size_t BitPackedBytes(size_t count, unsigned width) {
+    return (count * width + 7) / 8;
+}
+
+size_t BitPack(const uint32_t* values, size_t count, unsigned width, uint8_t* out) {
+    size_t bytes = BitPackedBytes(count, width);
+    if (width == 0) return 0;
+
+    std::memset(out, 0, bytes);
+    size_t bit = 0;
+    for (size_t i = 0; i < count; ++i, bit += width) {
+        uint64_t shifted = static_cast<uint64_t>(values[i]) << (bit % 8);
+        for (size_t byte = bit / 8; shifted != 0; ++byte, shifted >>= 8) {
+            out[byte] |= static_cast<uint8_t>(shifted);
+        }
+    }
+    return bytes;
+}
+
+void BitUnpack(const uint8_t* in, size_t count, unsigned width, uint32_t* out) {
+    if (width == 0) {
+        std::memset(out, 0, count * sizeof(uint32_t));
+        return;
+    }
+
+    const uint64_t mask = (1ull << width) - 1;
+    size_t total_bytes = BitPackedBytes(count, width);
+    size_t bit = 0;
+    for (size_t i = 0; i < count; ++i, bit += width) {
+        // Up to 8 bytes around the value; never read past the packed data.
+        size_t first = bit / 8;
+        size_t available = total_bytes - first < 8 ? total_bytes - first : 8;
+        uint64_t window = 0;
+        std::memcpy(&window, in + first, available);
+        out[i] = static_cast<uint32_t>((window >> (bit % 8)) & mask);
+    }
+}
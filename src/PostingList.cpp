@@ -0,0 +1,310 @@
+#include "PostingList.h"
+#include "PostingCodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+static constexpr size_t kHeaderBytes = 12;
+static constexpr size_t kBlockHeaderBytes = 12;
+
+static void WriteUint32(std::vector<uint8_t>& out, size_t offset, uint32_t value) {
+    std::memcpy(out.data() + offset, &value, sizeof(value));
+}
+
+PostingList PostingList::View(const uint8_t* bytes, size_t size) {
+    PostingList list;
+    if (size > 0) {
+        list.bytes = bytes;
+        list.byte_size = size;
+    }
+    return list;
+}
+
+PostingList::PostingList(const PostingList& other) {
+    *this = other;
+}
+
+PostingList& PostingList::operator=(const PostingList& other) {
+    if (this == &other) return *this;
+
+    owned = other.owned;
+    decoded = other.decoded;
+    byte_size = other.byte_size;
+    bytes = other.owned.empty() ? other.bytes : owned.data();
+    return *this;
+}
+
+PostingList::PostingList(PostingList&& other) noexcept {
+    *this = std::move(other);
+}
+
+PostingList& PostingList::operator=(PostingList&& other) noexcept {
+    if (this == &other) return *this;
+
+    // Moving a vector keeps its buffer, so bytes stays valid either way.
+    owned = std::move(other.owned);
+    decoded = std::move(other.decoded);
+    bytes = std::exchange(other.bytes, nullptr);
+    byte_size = std::exchange(other.byte_size, 0);
+    other.owned.clear();
+    return *this;
+}
+
+bool PostingList::operator==(const PostingList& other) const {
+    return byte_size == other.byte_size &&
+           (byte_size == 0 || std::memcmp(bytes, other.bytes, byte_size) == 0);
+}
+
+PostingList::PostingList(const std::vector<Posting>& postings) {
+    if (postings.empty()) return;
+
+    std::vector<uint8_t> payload;
+    PostingListEncoder encoder([&](const uint8_t* data, size_t size) {
+        payload.insert(payload.end(), data, data + size);
+    });
+    for (const Posting& posting : postings) encoder.Add(posting);
+
+    owned = encoder.Finish();
+    owned.insert(owned.end(), payload.begin(), payload.end());
+    owned.shrink_to_fit();
+    bytes = owned.data();
+    byte_size = owned.size();
+}
+
+uint32_t PostingList::ReadHeader(size_t offset) const {
+    uint32_t value;
+    std::memcpy(&value, bytes + offset, sizeof(value));
+    return value;
+}
+
+size_t PostingList::size() const {
+    return byte_size == 0 ? 0 : ReadHeader(0);
+}
+
+uint32_t PostingList::MaxTf() const {
+    return byte_size == 0 ? 0 : ReadHeader(8);
+}
+
+size_t PostingList::BlockCount() const {
+    return byte_size == 0 ? 0 : ReadHeader(4);
+}
+
+size_t PostingList::BlockSize(size_t block) const {
+    return std::min(kBlockSize, size() - block * kBlockSize);
+}
+
+uint32_t PostingList::BlockLastDocId(size_t block) const {
+    return ReadHeader(kHeaderBytes + block * kBlockHeaderBytes);
+}
+
+uint32_t PostingList::BlockMaxTf(size_t block) const {
+    return ReadHeader(kHeaderBytes + block * kBlockHeaderBytes + 8);
+}
+
+void PostingList::DecodeBlock(size_t block, uint32_t* doc_ids, uint32_t* tfs) const {
+    size_t n = BlockSize(block);
+    if (decoded) {
+        std::memcpy(doc_ids, decoded->doc_ids.data() + block * kBlockSize, n * sizeof(uint32_t));
+        std::memcpy(tfs, decoded->tfs.data() + block * kBlockSize, n * sizeof(uint32_t));
+        return;
+    }
+    uint32_t base = block == 0 ? 0 : BlockLastDocId(block - 1);
+
+    const uint8_t* in = bytes + ReadHeader(kHeaderBytes + block * kBlockHeaderBytes + 4);
+    const uint8_t* limit = bytes + byte_size;
+
+    unsigned width = *in++;
+    in = width <= 32 ? DecodeStreamVByteDeltas(in, limit, n, base, doc_ids) : nullptr;
+    // The last doc_id must match the header, which keeps the iterator's
+    // searches inside the block.
+    if (in == nullptr || BitPackedBytes(n, width) > static_cast<size_t>(limit - in) ||
+        doc_ids[n - 1] != BlockLastDocId(block)) {
+        throw std::runtime_error("PostingList: corrupt block " + std::to_string(block));
+    }
+    BitUnpack(in, n, width, tfs);
+    for (size_t i = 0; i < n; ++i) ++tfs[i];
+}
+
+bool PostingList::VerifyHeaders() const {
+    if (byte_size == 0) return true;
+    if (byte_size < kHeaderBytes) return false;
+
+    size_t count = size();
+    size_t block_count = BlockCount();
+    if (count == 0 || block_count != (count + kBlockSize - 1) / kBlockSize ||
+        block_count > (byte_size - kHeaderBytes) / kBlockHeaderBytes) {
+        return false;
+    }
+    // Every block has a payload of at least its width byte.
+    size_t header_size = kHeaderBytes + block_count * kBlockHeaderBytes;
+    for (size_t block = 0; block < block_count; ++block) {
+        uint32_t offset = ReadHeader(kHeaderBytes + block * kBlockHeaderBytes + 4);
+        if (offset < header_size || offset >= byte_size) return false;
+    }
+    return true;
+}
+
+std::vector<Posting> PostingList::Decode() const {
+    std::vector<Posting> postings;
+    postings.reserve(size());
+    for (const Posting& posting : *this) postings.push_back(posting);
+    return postings;
+}
+
+PostingList PostingList::Decoded() const {
+    if (decoded || empty()) return *this;
+
+    auto blocks = std::make_shared<DecodedBlocks>();
+    blocks->bytes.assign(bytes, bytes + byte_size);
+    blocks->doc_ids.resize(size());
+    blocks->tfs.resize(size());
+    for (size_t block = 0; block < BlockCount(); ++block) {
+        DecodeBlock(block, blocks->doc_ids.data() + block * kBlockSize, blocks->tfs.data() + block * kBlockSize);
+    }
+
+    PostingList list;
+    list.bytes = blocks->bytes.data();
+    list.byte_size = byte_size;
+    list.decoded = std::move(blocks);
+    return list;
+}
+
+size_t PostingList::MemoryBytes() const {
+    size_t memory = owned.capacity();
+    if (decoded) {
+        memory += decoded->bytes.capacity() +
+                  (decoded->doc_ids.capacity() + decoded->tfs.capacity()) * sizeof(uint32_t);
+    }
+    return memory;
+}
+
+size_t PostingList::FindBlock(uint32_t doc_id, size_t from) const {
+    size_t count = BlockCount();
+    size_t low = from;
+    size_t high = from;
+    for (size_t step = 1; high < count && BlockLastDocId(high) < doc_id; step *= 2) {
+        low = high + 1;
+        high += step;
+    }
+    high = std::min(high, count);
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (BlockLastDocId(middle) < doc_id) low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+size_t PostingList::at(size_t doc_id) const {
+    size_t block = doc_id < kEndDocId ? FindBlock(static_cast<uint32_t>(doc_id)) : BlockCount();
+    if (block < BlockCount()) {
+        uint32_t doc_ids[kBlockSize];
+        uint32_t tfs[kBlockSize];
+        DecodeBlock(block, doc_ids, tfs);
+
+        size_t n = BlockSize(block);
+        auto it = std::lower_bound(doc_ids, doc_ids + n, static_cast<uint32_t>(doc_id));
+        if (it != doc_ids + n && *it == doc_id) return tfs[it - doc_ids];
+    }
+
+    throw std::out_of_range("PostingList::at: no posting for document " + std::to_string(doc_id));
+}
+
+PostingList::const_iterator::const_iterator(const PostingList* list, size_t block)
+    : list(list), block(block) {
+    Load();
+}
+
+void PostingList::const_iterator::Load() {
+    index = 0;
+    if (block >= list->BlockCount()) {
+        current = {kEndDocId, 0};
+        return;
+    }
+
+    block_size = list->BlockSize(block);
+    list->DecodeBlock(block, doc_ids, tfs);
+    current = {doc_ids[0], tfs[0]};
+}
+
+PostingList::const_iterator& PostingList::const_iterator::operator++() {
+    if (++index == block_size) {
+        ++block;
+        Load();
+    } else {
+        current = {doc_ids[index], tfs[index]};
+    }
+    return *this;
+}
+
+void PostingList::const_iterator::Advance(uint32_t target) {
+    if (current.doc_id >= target) return;
+
+    size_t next = list->FindBlock(target, block);
+    if (next != block) {
+        block = next;
+        Load();
+        if (block == list->BlockCount()) return;
+    }
+
+    // The block's last doc_id is not below target: gallop to it.
+    size_t low = index;
+    size_t high = index;
+    for (size_t step = 1; high < block_size && doc_ids[high] < target; step *= 2) {
+        low = high + 1;
+        high += step;
+    }
+    index = static_cast<size_t>(std::lower_bound(doc_ids + low, doc_ids + std::min(high, block_size), target) - doc_ids);
+    current = {doc_ids[index], tfs[index]};
+}
+
+void PostingListEncoder::Add(const Posting& posting) {
+    gaps[pending] = posting.doc_id - previous;
+    tfs[pending] = posting.tf - 1;
+    previous = posting.doc_id;
+    ++count;
+    if (++pending == PostingList::kBlockSize) EncodeBlock();
+}
+
+void PostingListEncoder::EncodeBlock() {
+    uint32_t block_max_tf = 0;
+    for (size_t i = 0; i < pending; ++i) block_max_tf = std::max(block_max_tf, tfs[i]);
+    max_tf = std::max(max_tf, block_max_tf + 1);
+
+    block_headers.push_back(previous);
+    block_headers.push_back(static_cast<uint32_t>(payload_size));
+    block_headers.push_back(block_max_tf + 1);
+
+    unsigned width = BitWidth(block_max_tf);
+    encoded.resize(1 + StreamVByteMaxBytes(PostingList::kBlockSize) + PostingList::kBlockSize * 4);
+    size_t size = 0;
+    encoded[size++] = static_cast<uint8_t>(width);
+    size += EncodeStreamVByte(gaps, pending, encoded.data() + size);
+    size += BitPack(tfs, pending, width, encoded.data() + size);
+
+    write(encoded.data(), size);
+    payload_size += size;
+    pending = 0;
+}
+
+std::vector<uint8_t> PostingListEncoder::Finish() {
+    if (pending > 0) EncodeBlock();
+
+    size_t block_count = block_headers.size() / 3;
+    size_t header_size = kHeaderBytes + block_count * kBlockHeaderBytes;
+    for (size_t block = 0; block < block_count; ++block) {
+        block_headers[block * 3 + 1] += static_cast<uint32_t>(header_size);
+    }
+
+    std::vector<uint8_t> header(header_size);
+    WriteUint32(header, 0, static_cast<uint32_t>(count));
+    WriteUint32(header, 4, static_cast<uint32_t>(block_count));
+    WriteUint32(header, 8, max_tf);
+    if (block_count > 0) {
+        std::memcpy(header.data() + kHeaderBytes, block_headers.data(), block_headers.size() * sizeof(uint32_t));
+    }
+    return header;
+}
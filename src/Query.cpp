@@ -0,0 +1,333 @@
+#include "Query.h"
+#include "Tokenizer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <utility>
+
+using Node = Query::Node;
+
+namespace {
+
+// A request split into words, phrases, operators and parentheses
+struct Item {
+    enum class Kind { Word, Phrase, Near, And, Or, Not, Open, Close };
+
+    Item(Kind kind, std::vector<std::string> words = {}, uint32_t distance = 0)
+        : kind(kind), words(std::move(words)), distance(distance) {}
+
+    Kind kind;
+    std::vector<std::string> words;
+    uint32_t distance;
+};
+
+std::vector<std::string> Tokenize(std::string_view text) {
+    Tokenizer tokenizer(text);
+    std::vector<std::string> words;
+    std::string_view word;
+    while (tokenizer.Next(word)) words.emplace_back(word);
+    return words;
+}
+
+bool IsSpace(char c) {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+bool IsDelimiter(char c) {
+    return IsSpace(c) || c == '"' || c == '(' || c == ')';
+}
+
+// NEAR/k with k made of digits only
+bool ParseNear(std::string_view chunk, uint32_t& distance) {
+    constexpr std::string_view kOperator = "NEAR/";
+    if (chunk.size() <= kOperator.size() || chunk.substr(0, kOperator.size()) != kOperator) return false;
+
+    uint64_t value = 0;
+    for (char c : chunk.substr(kOperator.size())) {
+        if (!std::isdigit(static_cast<unsigned char>(c))) return false;
+        value = std::min<uint64_t>(value * 10 + static_cast<uint64_t>(c - '0'), UINT32_MAX);
+    }
+    distance = static_cast<uint32_t>(value);
+    return true;
+}
+
+std::vector<Item> Lex(std::string_view request) {
+    std::vector<Item> items;
+
+    size_t i = 0;
+    while (i < request.size()) {
+        char c = request[i];
+        if (IsSpace(c)) {
+            ++i;
+        } else if (c == '(' || c == ')') {
+            items.push_back({c == '(' ? Item::Kind::Open : Item::Kind::Close});
+            ++i;
+        } else if (c == '"') {
+            // An unterminated phrase runs to the end of the request.
+            size_t close = request.find('"', i + 1);
+            if (close == std::string_view::npos) close = request.size();
+
+            std::vector<std::string> words = Tokenize(request.substr(i + 1, close - i - 1));
+            if (words.size() > 1) {
+                items.push_back({Item::Kind::Phrase, std::move(words)});
+            } else if (words.size() == 1) {
+                items.push_back({Item::Kind::Word, std::move(words)});
+            }
+            i = close + 1;
+        } else {
+            size_t end = i;
+            while (end < request.size() && !IsDelimiter(request[end])) ++end;
+
+            std::string_view chunk = request.substr(i, end - i);
+            uint32_t distance;
+            if (chunk == "AND") {
+                items.push_back({Item::Kind::And});
+            } else if (chunk == "OR") {
+                items.push_back({Item::Kind::Or});
+            } else if (chunk == "NOT") {
+                items.push_back({Item::Kind::Not});
+            } else if (ParseNear(chunk, distance)) {
+                items.push_back({Item::Kind::Near, {}, distance});
+            } else {
+                for (auto& word : Tokenize(chunk)) items.push_back({Item::Kind::Word, {std::move(word)}});
+            }
+            i = end;
+        }
+    }
+    return items;
+}
+
+Node MakeNode(Node::Kind kind, std::vector<std::string> words = {}, uint32_t distance = 0) {
+    Node node;
+    node.kind = kind;
+    node.words = std::move(words);
+    node.distance = distance;
+    return node;
+}
+
+// Recursive descent over the items:
+//
+//   or      := and { [OR] and }
+//   and     := unary { { AND } unary }
+//   unary   := { NOT } primary
+//   primary := ( or ) | phrase | word { NEAR/k word }
+class Parser {
+public:
+    explicit Parser(std::vector<Item> items) : items(std::move(items)) {}
+
+    Node Parse() {
+        Node root = ParseOr();
+        // Unbalanced closing parentheses are skipped.
+        while (at < items.size()) {
+            ++at;
+            Node more = ParseOr();
+            Node both = MakeNode(Node::Kind::Or);
+            both.children.push_back(std::move(root));
+            both.children.push_back(std::move(more));
+            root = std::move(both);
+        }
+        return root;
+    }
+
+private:
+    bool At(Item::Kind kind) const { return at < items.size() && items[at].kind == kind; }
+
+    Node ParseOr() {
+        Node node = MakeNode(Node::Kind::Or);
+        while (at < items.size() && !At(Item::Kind::Close)) {
+            if (At(Item::Kind::Or)) {
+                ++at;
+                continue;
+            }
+            node.children.push_back(ParseAnd());
+        }
+        return node;
+    }
+
+    Node ParseAnd() {
+        Node node = MakeNode(Node::Kind::And);
+        bool negated;
+        Node first = ParseUnary(negated);
+        (negated ? node.excluded : node.children).push_back(std::move(first));
+
+        while (true) {
+            if (At(Item::Kind::And) || At(Item::Kind::Not)) {
+                // AND NOT, NOT and repeated ANDs all join the operand.
+                while (At(Item::Kind::And)) ++at;
+                Node operand = ParseUnary(negated);
+                (negated ? node.excluded : node.children).push_back(std::move(operand));
+            } else {
+                return node;
+            }
+        }
+    }
+
+    Node ParseUnary(bool& negated) {
+        negated = false;
+        for (; At(Item::Kind::Not); ++at) negated = !negated;
+        return ParsePrimary();
+    }
+
+    Node ParsePrimary() {
+        if (at == items.size() || At(Item::Kind::Close)) return Node();
+
+        Item& item = items[at++];
+        switch (item.kind) {
+        case Item::Kind::Open: {
+            Node inner = ParseOr();
+            if (At(Item::Kind::Close)) ++at;
+            return inner;
+        }
+        case Item::Kind::Phrase:
+            return MakeNode(Node::Kind::Phrase, std::move(item.words));
+        case Item::Kind::Word:
+            return ParseWord(std::move(item.words.front()));
+        default:
+            // A misplaced operator
+            return Node();
+        }
+    }
+
+    Node ParseWord(std::string word) {
+        if (!At(Item::Kind::Near) || at + 1 == items.size() || items[at + 1].kind != Item::Kind::Word) {
+            return MakeNode(Node::Kind::Term, {std::move(word)});
+        }
+
+        Node near = MakeNode(Node::Kind::Near, {std::move(word)});
+        while (At(Item::Kind::Near) && at + 1 < items.size() && items[at + 1].kind == Item::Kind::Word) {
+            near.distance = std::max(near.distance, items[at].distance);
+            near.words.push_back(std::move(items[at + 1].words.front()));
+            at += 2;
+        }
+
+        std::sort(near.words.begin(), near.words.end());
+        near.words.erase(std::unique(near.words.begin(), near.words.end()), near.words.end());
+        // A word near itself is just the word.
+        if (near.words.size() == 1) return MakeNode(Node::Kind::Term, std::move(near.words));
+        return near;
+    }
+
+    std::vector<Item> items;
+    size_t at = 0;
+};
+
+// Terms first, sorted and unique; other operands keep their order.
+void SortOperands(std::vector<Node>& operands) {
+    auto others = std::stable_partition(operands.begin(), operands.end(),
+        [](const Node& node) { return node.kind == Node::Kind::Term; });
+    std::sort(operands.begin(), others,
+        [](const Node& a, const Node& b) { return a.words < b.words; });
+    auto last = std::unique(operands.begin(), others);
+    operands.erase(last, others);
+}
+
+// Flattens nested operators of the same kind and drops empty operands
+Node Simplify(Node node) {
+    if (node.kind != Node::Kind::And && node.kind != Node::Kind::Or) return node;
+
+    std::vector<Node> children;
+    std::vector<Node> excluded;
+    for (auto& child : node.children) {
+        Node simple = Simplify(std::move(child));
+        if (simple.empty()) continue;
+
+        if (simple.kind == node.kind) {
+            for (auto& grandchild : simple.children) children.push_back(std::move(grandchild));
+            for (auto& grandchild : simple.excluded) excluded.push_back(std::move(grandchild));
+        } else {
+            children.push_back(std::move(simple));
+        }
+    }
+    // NOT (a OR b) excludes a and b one by one.
+    for (auto& child : node.excluded) {
+        Node simple = Simplify(std::move(child));
+        if (simple.kind == Node::Kind::Or) {
+            for (auto& grandchild : simple.children) excluded.push_back(std::move(grandchild));
+        } else {
+            excluded.push_back(std::move(simple));
+        }
+    }
+
+    SortOperands(children);
+    SortOperands(excluded);
+
+    if (children.empty()) return Node();
+    if (children.size() == 1 && excluded.empty()) return std::move(children.front());
+
+    node.children = std::move(children);
+    node.excluded = std::move(excluded);
+    return node;
+}
+
+void Format(const Node& node, std::string& out) {
+    auto join = [&](const std::vector<std::string>& words, const char* separator) {
+        for (size_t i = 0; i < words.size(); ++i) {
+            if (i > 0) out += separator;
+            out += words[i];
+        }
+    };
+
+    switch (node.kind) {
+    case Node::Kind::Term:
+        out += node.words.front();
+        break;
+    case Node::Kind::Phrase:
+        out += '"';
+        join(node.words, " ");
+        out += '"';
+        break;
+    case Node::Kind::Near:
+        out += '(';
+        join(node.words, (" NEAR/" + std::to_string(node.distance) + " ").c_str());
+        out += ')';
+        break;
+    case Node::Kind::And:
+    case Node::Kind::Or:
+        out += '(';
+        for (size_t i = 0; i < node.children.size(); ++i) {
+            if (i > 0) out += node.kind == Node::Kind::And ? " AND " : " OR ";
+            Format(node.children[i], out);
+        }
+        for (const auto& excluded : node.excluded) {
+            out += " NOT ";
+            Format(excluded, out);
+        }
+        out += ')';
+        break;
+    }
+}
+
+} // namespace
+
+bool Node::operator==(const Node& other) const {
+    return kind == other.kind && words == other.words && distance == other.distance &&
+           children == other.children && excluded == other.excluded;
+}
+
+Query Query::Parse(std::string_view request) {
+    Query query;
+    query.root = Simplify(Parser(Lex(request)).Parse());
+    return query;
+}
+
+bool Query::PlainWords(std::vector<std::string>& words) const {
+    words.clear();
+    if (root.kind == Node::Kind::Term) {
+        words = root.words;
+        return true;
+    }
+    if (root.kind != Node::Kind::Or || root.empty()) return false;
+
+    for (const auto& child : root.children) {
+        if (child.kind != Node::Kind::Term) return false;
+        words.push_back(child.words.front());
+    }
+    // Or keeps its terms sorted and unique already.
+    return true;
+}
+
+std::string Query::ToString() const {
+    std::string out;
+    if (!empty()) Format(root, out);
+    return out;
+}
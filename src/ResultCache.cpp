@@ -0,0 +1,23 @@
+#include "ResultCache.h"
+
+// Approximate footprint of an entry: list and hash nodes, the query twice
+// (entry and map key) and the results
+static size_t EntryBytes(const std::string& query, size_t result_count) {
+    constexpr size_t kNodeBytes = 128;
+    return kNodeBytes + 2 * query.size() + result_count * sizeof(RelativeIndex);
+}
+
+bool ResultCache::Get(const std::string& query, uint64_t generation, std::vector<RelativeIndex>& results) {
+    // An entry computed on another snapshot is dropped.
+    return lru.Find(query, [&](const Cached& cached) {
+        if (cached.generation != generation) return false;
+        results = cached.results;
+        return true;
+    });
+}
+
+void ResultCache::Put(const std::string& query, uint64_t generation, const std::vector<RelativeIndex>& results) {
+    // A search on an older snapshot finishing late keeps the newer entry.
+    lru.Put(query, {generation, results}, EntryBytes(query, results.size()),
+            [&](const Cached& cached) { return cached.generation > generation; });
+}
@@ -1,106 +1,696 @@
 #include "SearchServer.h"
+#include "Intersect.h"
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <utility>
 #include <vector>
-#include <unordered_set>
-#include <sstream>
 
-std::vector<std::string> SearchServer::processQuery(const std::string& query) {
-    std::stringstream ss(query);
-    std::vector<std::string> words;
-    std::string word;
+namespace {
+
+// First index in [from, to) whose value is not below target, or to. The
+// search gallops from `from`, so its cost grows with the log of the
+// distance moved rather than with the size of the range.
+template <typename Value>
+size_t Gallop(size_t from, size_t to, size_t target, Value value) {
+    size_t low = from;
+    size_t high = from;
+    for (size_t step = 1; high < to && value(high) < target; step *= 2) {
+        low = high + 1;
+        high += step;
+    }
+    high = std::min(high, to);
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (value(middle) < target) low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+// Calls match(c, index, tf) for every candidate docs[c] found in postings,
+// in order of c; index is the posting's index in the list. docs is sorted;
+// blocks holding no candidate are never decoded, the others are
+// intersected with their candidates by IntersectSorted. match may
+// overwrite docs[0, c].
+template <typename Match>
+void IntersectPostings(const PostingList& postings, const uint32_t* docs, size_t count, Match match) {
+    uint32_t doc_ids[PostingList::kBlockSize];
+    uint32_t tfs[PostingList::kBlockSize];
+    uint32_t doc_matches[PostingList::kBlockSize];
+    uint32_t block_matches[PostingList::kBlockSize];
 
-    while (ss >> word) {
-        while (!word.empty() && ispunct(word.back())) {
-            word.pop_back();
+    size_t block = 0;
+    size_t c = 0;
+    while (c < count) {
+        block = postings.FindBlock(docs[c], block);
+        if (block == postings.BlockCount()) return;
+
+        // Candidates up to the block's last doc_id; at most a block's worth
+        // can match.
+        size_t last = postings.BlockLastDocId(block);
+        size_t end = Gallop(c, count, last + 1, [&](size_t i) { return docs[i]; });
+        postings.DecodeBlock(block, doc_ids, tfs);
+        size_t matched = IntersectSorted(docs + c, end - c, doc_ids, postings.BlockSize(block),
+                                         doc_matches, block_matches);
+
+        for (size_t m = 0; m < matched; ++m) {
+            match(c + doc_matches[m], static_cast<uint32_t>(block * PostingList::kBlockSize + block_matches[m]),
+                  tfs[block_matches[m]]);
         }
-        if (!word.empty()) {
-            words.push_back(word);
+        c = end;
+        ++block;
+    }
+}
+
+// Doc ids of ranked documents, for the intersection kernels
+std::vector<uint32_t> DocIds(const std::vector<RelativeIndex>& ranked_docs) {
+    std::vector<uint32_t> doc_ids;
+    doc_ids.reserve(ranked_docs.size());
+    for (const auto& doc : ranked_docs) doc_ids.push_back(static_cast<uint32_t>(doc.doc_id));
+    return doc_ids;
+}
+
+} // namespace
+
+// Occurrences of a phrase: slot_terms[i] is the term of the phrase's i-th
+// word, positions[t] the sorted positions of term t in one document.
+static size_t CountPhrase(const std::vector<std::vector<uint32_t>>& positions,
+                          const std::vector<size_t>& slot_terms) {
+    // Every occurrence has one position per slot; try those of the slot
+    // with the fewest positions.
+    size_t anchor = 0;
+    for (size_t slot = 1; slot < slot_terms.size(); ++slot) {
+        if (positions[slot_terms[slot]].size() < positions[slot_terms[anchor]].size()) anchor = slot;
+    }
+
+    size_t count = 0;
+    for (uint32_t position : positions[slot_terms[anchor]]) {
+        if (position < anchor) continue;
+        uint32_t start = position - static_cast<uint32_t>(anchor);
+
+        bool match = true;
+        for (size_t slot = 0; slot < slot_terms.size() && match; ++slot) {
+            const auto& list = positions[slot_terms[slot]];
+            match = std::binary_search(list.begin(), list.end(), start + static_cast<uint32_t>(slot));
         }
+        if (match) ++count;
     }
+    return count;
+}
 
-    std::sort(words.begin(), words.end());
-    words.erase(std::unique(words.begin(), words.end()), words.end());
+// Non-overlapping windows of at most distance positions that contain every
+// term, found by always advancing the term that is furthest behind.
+static size_t CountNear(const std::vector<std::vector<uint32_t>>& positions, uint32_t distance) {
+    std::vector<size_t> at(positions.size(), 0);
+    size_t count = 0;
+
+    while (true) {
+        size_t lowest = 0;
+        uint32_t high = 0;
+        for (size_t t = 0; t < positions.size(); ++t) {
+            if (positions[t][at[t]] < positions[lowest][at[lowest]]) lowest = t;
+            high = std::max(high, positions[t][at[t]]);
+        }
 
-    return words;
+        if (high - positions[lowest][at[lowest]] <= distance) {
+            ++count;
+            for (size_t t = 0; t < positions.size(); ++t) {
+                if (++at[t] == positions[t].size()) return count;
+            }
+        } else if (++at[lowest] == positions[lowest].size()) {
+            return count;
+        }
+    }
+}
+
+static bool RanksBetter(const RelativeIndex& a, const RelativeIndex& b) {
+    return a.rank > b.rank || (a.rank == b.rank && a.doc_id < b.doc_id);
+}
+
+void TopK::Push(const RelativeIndex& doc) {
+    if (!Full()) {
+        heap.push_back(doc);
+        if (k > 0) std::push_heap(heap.begin(), heap.end(), RanksBetter);
+    } else if (RanksBetter(doc, heap.front())) {
+        std::pop_heap(heap.begin(), heap.end(), RanksBetter);
+        heap.back() = doc;
+        std::push_heap(heap.begin(), heap.end(), RanksBetter);
+    }
+}
+
+std::vector<RelativeIndex> TopK::Take() {
+    // Without a bound the heap was never built; a plain sort will do.
+    if (k > 0) std::sort_heap(heap.begin(), heap.end(), RanksBetter);
+    else std::sort(heap.begin(), heap.end(), RanksBetter);
+    return std::move(heap);
+}
+
+Query SearchServer::processQuery(const std::string& request) {
+    return Query::Parse(request);
+}
+
+ThreadPool& SearchServer::pool() {
+    std::call_once(_pool_created, [this] { _pool = std::make_unique<ThreadPool>(_thread_count); });
+    return *_pool;
 }
 
 std::vector<std::vector<RelativeIndex>> SearchServer::search(const std::vector<std::string>& input_requests)
 {
-    std::vector<std::vector<RelativeIndex>> results;
+    std::vector<std::vector<RelativeIndex>> results(input_requests.size());
 
-    _index.UpdateDocumentBase();
+    // Search runs against the current generation; the index is only built
+    // here if nobody did it before. Reindexing is up to the caller
+    // (UpdateDocumentBase or Refresh).
+    if (_index.Generation() == 0) {
+        _index.UpdateDocumentBase();
+    }
 
-    for (const auto& request : input_requests)
-    {
-        auto words = processQuery(request);
+    // The whole batch sees one version of the index, however long it
+    // takes and whatever updates or merges run meanwhile.
+    auto snapshot = _index.GetSnapshot();
 
-        if (words.empty()) {
-            results.emplace_back();
-            continue;
-        }
+    // Requests are independent and each one writes only its own slot.
+    // A lone request may use the pool itself instead.
+    if (input_requests.size() == 1) {
+        results[0] = searchRequest(*snapshot, input_requests[0], true);
+    } else if (!input_requests.empty()) {
+        pool().ForEach(input_requests.size(), [&](size_t i) {
+            results[i] = searchRequest(*snapshot, input_requests[i], false);
+        });
+    }
 
-        auto doc_ids = findMatchingDocs(words); // here
+    return results;
+}
 
-        if (doc_ids.empty()) {
-            results.emplace_back();
-            continue;
+std::vector<RelativeIndex> SearchServer::searchRequest(const InvertedIndex::Snapshot& snapshot,
+                                                       const std::string& request, bool partition) {
+    auto query = processQuery(request);
+    if (query.empty()) return {};
+
+    // Equivalent spellings of a query share the canonical form, and the
+    // generation ties cached results to the snapshot they came from.
+    std::string key = query.ToString();
+    std::vector<RelativeIndex> cached;
+    if (_cache.Get(key, snapshot.generation, cached)) return cached;
+
+    // Live postings of a document are in exactly one segment, so the
+    // per-segment results go straight into the top k. With a limit,
+    // plain word queries are pruned against it.
+    TopK top(_max_responses);
+    std::vector<std::string> words;
+    bool plain = query.PlainWords(words);
+    if (plain) {
+        // Words in no segment add nothing; the snapshot remembers them, so
+        // a repeated misspelling is not looked up in every segment again.
+        words.erase(std::remove_if(words.begin(), words.end(),
+            [&](const std::string& word) { return !snapshot.HasTerm(word); }), words.end());
+    }
+    bool prune = _max_responses > 0 && plain;
+    bool absent = plain && words.empty();
+    if (!absent && !(prune && partition && rankPartitioned(snapshot, words, top))) {
+        for (const auto& segment : snapshot.segments) {
+            if (prune) {
+                rankTopK(segment, resolveTerms(segment, words), top);
+                continue;
+            }
+            for (const auto& doc : evaluate(segment, query.root)) top.Push(doc);
         }
+    }
+
+    auto ranked_docs = top.Take();
+    normalizeRanks(ranked_docs);
+    _cache.Put(key, snapshot.generation, ranked_docs);
+    return ranked_docs;
+}
+
+std::vector<uint32_t> SearchServer::resolveTerms(const LiveSegment& segment, const std::vector<std::string>& words) {
+    std::vector<uint32_t> term_ids;
+    term_ids.reserve(words.size());
 
-        results.push_back(rankDocuments(doc_ids, words));
+    for (const auto& word : words) {
+        uint32_t term_id = segment.segment->FindTerm(word);
+        if (term_id != Segment::kNoTerm) {
+            term_ids.push_back(term_id);
+        }
     }
 
-    return results;
+    return term_ids;
 }
 
-std::vector<size_t> SearchServer::findMatchingDocs(const std::vector<std::string>& words) {
-    if (words.empty()) return {};
+std::vector<PostingList> SearchServer::readPostings(const LiveSegment& segment, const std::vector<uint32_t>& term_ids) {
+    std::vector<PostingList> lists;
+    lists.reserve(term_ids.size());
+    for (uint32_t term_id : term_ids) lists.push_back(_index.TermPostings(segment, term_id));
+    return lists;
+}
 
-    std::unordered_set<size_t> result;
+std::vector<size_t> SearchServer::findMatchingDocs(const LiveSegment& segment, const std::vector<PostingList>& lists) {
+    if (lists.empty()) return {};
 
-    for (const auto& word : words) {
-        const auto& word_counts = _index.GetWordCount(word);
-        for (const auto& [doc_id, count] : word_counts) {
-            result.insert(doc_id);
+    // Union of the sorted posting lists, merged pairwise
+    std::vector<size_t> result;
+    std::vector<size_t> merged;
+
+    for (const PostingList& postings : lists) {
+        merged.clear();
+        merged.reserve(result.size() + postings.size());
+
+        auto doc = result.begin();
+        for (const Posting& posting : postings) {
+            if (segment.IsDeleted(posting.doc_id)) continue;
+
+            while (doc != result.end() && *doc < posting.doc_id) merged.push_back(*doc++);
+            if (doc != result.end() && *doc == posting.doc_id) ++doc;
+            merged.push_back(posting.doc_id);
         }
+        merged.insert(merged.end(), doc, result.end());
+
+        result.swap(merged);
     }
 
-    return std::vector<size_t>(result.begin(), result.end());
+    return result;
 }
 
 std::vector<RelativeIndex> SearchServer::rankDocuments(
+    const LiveSegment& segment,
     const std::vector<size_t>& doc_ids,
-    const std::vector<std::string>& words
+    const std::vector<PostingList>& lists
 ) {
+    std::vector<float> abs_ranks(doc_ids.size(), 0);
+
+    // doc_ids is sorted and contains every live posting of every term, so
+    // each list is walked once alongside it.
+    for (const PostingList& postings : lists) {
+        size_t i = 0;
+        for (const Posting& posting : postings) {
+            if (segment.IsDeleted(posting.doc_id)) continue;
+
+            while (doc_ids[i] < posting.doc_id) ++i;
+            abs_ranks[i] += posting.tf;
+        }
+    }
+
     std::vector<RelativeIndex> ranked_docs;
     ranked_docs.reserve(doc_ids.size());
-    std::vector<float> abs_ranks;
-    abs_ranks.reserve(doc_ids.size());
-
-    for (auto doc_id : doc_ids) {
-        float rank = 0;
-        for (const auto& word : words) {
-            const auto& word_counts = _index.GetWordCount(word);
-            auto it = word_counts.find(doc_id);
-            if (it != word_counts.end()) {
-                rank += it->second;
+    for (size_t i = 0; i < doc_ids.size(); ++i) {
+        ranked_docs.push_back({doc_ids[i], abs_ranks[i]});
+    }
+
+    return ranked_docs;
+}
+
+void SearchServer::rankTopK(const LiveSegment& segment, const std::vector<uint32_t>& term_ids, TopK& top,
+                            uint32_t begin, uint32_t end, std::atomic<float>* shared_threshold) {
+    // Document-at-a-time over one iterator per term. An exhausted iterator
+    // sits at kEndDocId, past every document.
+    struct Cursor {
+        const PostingList* postings;
+        PostingList::const_iterator it;
+    };
+    std::vector<PostingList> lists = readPostings(segment, term_ids);
+
+    std::vector<Cursor> cursors;
+    for (const auto& list : lists) {
+        cursors.push_back({&list, list.begin()});
+        cursors.back().it.Advance(begin);
+    }
+
+    std::vector<Cursor*> order;
+    for (auto& cursor : cursors) order.push_back(&cursor);
+    auto by_doc = [](const Cursor* a, const Cursor* b) { return a->it->doc_id < b->it->doc_id; };
+
+    while (true) {
+        std::sort(order.begin(), order.end(), by_doc);
+
+        // Pivot: the first cursor at which the summed list bounds reach the
+        // k-th rank. Documents before its doc_id only hold earlier terms and
+        // cannot make it. A rank equal to the k-th may still win on doc_id.
+        float threshold = top.Full() ? top.Worst().rank : 0;
+        if (shared_threshold) threshold = std::max(threshold, shared_threshold->load(std::memory_order_relaxed));
+        float bound = 0;
+        size_t pivot = order.size();
+        for (size_t i = 0; i < order.size() && order[i]->it->doc_id != PostingList::kEndDocId; ++i) {
+            bound += static_cast<float>(order[i]->postings->MaxTf());
+            if (bound >= threshold) {
+                pivot = i;
+                break;
+            }
+        }
+        if (pivot == order.size()) return;
+
+        uint32_t pivot_doc = order[pivot]->it->doc_id;
+        if (pivot_doc >= end) return;
+        while (pivot + 1 < order.size() && order[pivot + 1]->it->doc_id == pivot_doc) ++pivot;
+
+        // Tighter bound from the blocks that would hold pivot_doc. If even
+        // that falls short, so does every document up to the end of the
+        // first of those blocks.
+        if (threshold > 0) {
+            float block_bound = 0;
+            uint32_t next = PostingList::kEndDocId;
+            for (size_t i = 0; i <= pivot; ++i) {
+                const PostingList& postings = *order[i]->postings;
+                size_t block = postings.FindBlock(pivot_doc, order[i]->it.Block());
+                if (block == postings.BlockCount()) continue;
+                block_bound += static_cast<float>(postings.BlockMaxTf(block));
+                next = std::min(next, postings.BlockLastDocId(block));
+            }
+            if (block_bound < threshold) {
+                uint32_t target = next == PostingList::kEndDocId ? next : next + 1;
+                if (pivot + 1 < order.size()) target = std::min(target, order[pivot + 1]->it->doc_id);
+                for (size_t i = 0; i <= pivot; ++i) order[i]->it.Advance(target);
+                continue;
+            }
+        }
+
+        if (order[0]->it->doc_id == pivot_doc) {
+            float rank = 0;
+            for (size_t i = 0; i <= pivot; ++i) rank += static_cast<float>(order[i]->it->tf);
+            if (!segment.IsDeleted(pivot_doc)) {
+                top.Push({pivot_doc, rank});
+                if (shared_threshold && top.Full()) {
+                    float worst = top.Worst().rank;
+                    float current = shared_threshold->load(std::memory_order_relaxed);
+                    while (current < worst && !shared_threshold->compare_exchange_weak(current, worst)) {}
+                }
             }
+            for (size_t i = 0; i <= pivot; ++i) order[i]->it.Advance(pivot_doc + 1);
+        } else {
+            for (size_t i = 0; order[i]->it->doc_id < pivot_doc; ++i) order[i]->it.Advance(pivot_doc);
         }
-        abs_ranks.push_back(rank);
     }
+}
 
-    float max_rank = *std::max_element(abs_ranks.begin(), abs_ranks.end());
+bool SearchServer::rankPartitioned(const InvertedIndex::Snapshot& snapshot, const std::vector<std::string>& words,
+                                   TopK& top) {
+    if (_partition_postings == 0) return false;
 
-    for (size_t i = 0; i < doc_ids.size(); ++i) {
-        ranked_docs.push_back({
-            doc_ids[i],
-            max_rank > 0 ? abs_ranks[i] / max_rank : 0
-        });
+    size_t postings = 0;
+    uint32_t last_doc_id = 0;
+    std::vector<std::vector<uint32_t>> segment_terms;
+    for (const auto& segment : snapshot.segments) {
+        segment_terms.push_back(resolveTerms(segment, words));
+        for (uint32_t term_id : segment_terms.back()) {
+            PostingList list = segment.segment->Postings(term_id);
+            postings += list.size();
+            if (!list.empty()) last_doc_id = std::max(last_doc_id, list.BlockLastDocId(list.BlockCount() - 1));
+        }
+    }
+    if (postings < _partition_postings) return false;
+
+    ThreadPool& workers = pool();
+    if (workers.Size() < 2) return false;
+
+    // More chunks than threads, so that chunks dense in matches do not
+    // leave the other threads waiting.
+    constexpr size_t kChunksPerThread = 4;
+    size_t chunks = workers.Size() * kChunksPerThread;
+    uint64_t width = (static_cast<uint64_t>(last_doc_id) + chunks) / chunks;
+
+    // A chunk's k-th rank bounds the global one from below, so every chunk
+    // may prune against the best of them.
+    std::atomic<float> threshold{0};
+    std::vector<TopK> tops(chunks, TopK(_max_responses));
+    workers.ForEach(chunks, [&](size_t c) {
+        uint32_t chunk_begin = static_cast<uint32_t>(std::min<uint64_t>(c * width, PostingList::kEndDocId));
+        uint32_t chunk_end = static_cast<uint32_t>(std::min<uint64_t>((c + 1) * width, PostingList::kEndDocId));
+        for (size_t s = 0; s < snapshot.segments.size(); ++s) {
+            rankTopK(snapshot.segments[s], segment_terms[s], tops[c], chunk_begin, chunk_end, &threshold);
+        }
+    });
+
+    for (auto& local : tops) {
+        for (const auto& doc : local.Take()) top.Push(doc);
     }
+    return true;
+}
+
+std::vector<RelativeIndex> SearchServer::evaluate(const LiveSegment& segment, const Query::Node& node) {
+    using Kind = Query::Node::Kind;
+
+    switch (node.kind) {
+    case Kind::Term:
+    case Kind::Or: {
+        // Plain words are ranked together in one pass over their lists.
+        std::vector<std::string> words;
+        for (const auto& child : node.children) {
+            if (child.kind == Kind::Term) words.push_back(child.words.front());
+        }
+        if (node.kind == Kind::Term) words = node.words;
+
+        auto lists = readPostings(segment, resolveTerms(segment, words));
+        std::vector<RelativeIndex> ranked_docs;
+        auto doc_ids = findMatchingDocs(segment, lists);
+        if (!doc_ids.empty()) ranked_docs = rankDocuments(segment, doc_ids, lists);
+
+        for (const auto& child : node.children) {
+            if (child.kind != Kind::Term) mergeRanks(ranked_docs, evaluate(segment, child));
+        }
+        return ranked_docs;
+    }
+    case Kind::Phrase:
+    case Kind::Near:
+        return matchProximity(segment, node);
+    case Kind::And:
+        return matchAll(segment, node);
+    }
+    return {};
+}
 
-    std::sort(ranked_docs.begin(), ranked_docs.end(),
-        [](const RelativeIndex& a, const RelativeIndex& b) {
-            return a.rank > b.rank;
+size_t SearchServer::estimateDocs(const LiveSegment& segment, const Query::Node& node) {
+    using Kind = Query::Node::Kind;
+
+    size_t estimate = 0;
+    switch (node.kind) {
+    case Kind::Term: {
+        uint32_t term_id = segment.segment->FindTerm(node.words.front());
+        return term_id == Segment::kNoTerm ? 0 : segment.segment->Postings(term_id).size();
+    }
+    case Kind::Phrase:
+    case Kind::Near:
+        estimate = std::numeric_limits<size_t>::max();
+        for (const auto& word : node.words) {
+            uint32_t term_id = segment.segment->FindTerm(word);
+            if (term_id == Segment::kNoTerm) return 0;
+            estimate = std::min(estimate, segment.segment->Postings(term_id).size());
+        }
+        return estimate;
+    case Kind::Or:
+        for (const auto& child : node.children) estimate += estimateDocs(segment, child);
+        return estimate;
+    case Kind::And:
+        estimate = std::numeric_limits<size_t>::max();
+        for (const auto& child : node.children) estimate = std::min(estimate, estimateDocs(segment, child));
+        return estimate;
+    }
+    return estimate;
+}
+
+std::vector<RelativeIndex> SearchServer::matchAll(const LiveSegment& segment, const Query::Node& node) {
+    using Kind = Query::Node::Kind;
+
+    std::vector<std::pair<size_t, const Query::Node*>> operands;
+    for (const auto& child : node.children) {
+        size_t estimate = estimateDocs(segment, child);
+        if (estimate == 0) return {};
+        operands.emplace_back(estimate, &child);
+    }
+    std::sort(operands.begin(), operands.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    // The rarest operand gives the candidates; every other one can only
+    // narrow them down. Term lists are only decoded in the blocks that
+    // could hold a candidate.
+    auto ranked_docs = evaluate(segment, *operands.front().second);
+    for (size_t i = 1; i < operands.size() && !ranked_docs.empty(); ++i) {
+        const Query::Node& operand = *operands[i].second;
+        if (operand.kind != Kind::Term) {
+            intersectRanks(ranked_docs, evaluate(segment, operand));
+            continue;
+        }
+
+        auto doc_ids = DocIds(ranked_docs);
+        size_t kept = 0;
+        IntersectPostings(_index.TermPostings(segment, segment.segment->FindTerm(operand.words.front())),
+            doc_ids.data(), doc_ids.size(), [&](size_t c, uint32_t, uint32_t tf) {
+                ranked_docs[kept++] = {ranked_docs[c].doc_id, ranked_docs[c].rank + static_cast<float>(tf)};
+            });
+        ranked_docs.resize(kept);
+    }
+
+    for (const auto& excluded : node.excluded) {
+        if (ranked_docs.empty()) break;
+        if (excluded.kind != Kind::Term) {
+            subtractDocs(ranked_docs, evaluate(segment, excluded));
+            continue;
+        }
+
+        uint32_t term_id = segment.segment->FindTerm(excluded.words.front());
+        if (term_id == Segment::kNoTerm) continue;
+
+        auto doc_ids = DocIds(ranked_docs);
+        size_t kept = 0;
+        size_t from = 0;
+        IntersectPostings(_index.TermPostings(segment, term_id), doc_ids.data(), doc_ids.size(),
+            [&](size_t c, uint32_t, uint32_t) {
+                while (from < c) ranked_docs[kept++] = ranked_docs[from++];
+                from = c + 1;
+            });
+        while (from < ranked_docs.size()) ranked_docs[kept++] = ranked_docs[from++];
+        ranked_docs.resize(kept);
+    }
+
+    return ranked_docs;
+}
+
+std::vector<RelativeIndex> SearchServer::matchProximity(const LiveSegment& segment, const Query::Node& clause) {
+    std::vector<std::string> words = clause.words;
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    auto term_ids = resolveTerms(segment, words);
+    if (term_ids.size() != words.size()) return {};
+
+    struct Hit {
+        uint32_t index;
+        uint32_t tf;
+    };
+    struct Term {
+        PostingList postings;
+        PositionList positions;
+        // Per candidate document: the posting's index in the list
+        std::vector<Hit> hits;
+    };
+
+    // Rarest term first: its documents are the candidates the others can
+    // only narrow down.
+    std::vector<Term> terms;
+    terms.reserve(term_ids.size());
+    for (uint32_t term_id : term_ids) {
+        terms.push_back({_index.TermPostings(segment, term_id), segment.segment->Positions(term_id), {}});
+    }
+    std::vector<size_t> order(terms.size());
+    for (size_t t = 0; t < order.size(); ++t) order[t] = t;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return terms[a].postings.size() < terms[b].postings.size();
+    });
+
+    std::vector<uint32_t> docs;
+    uint32_t index = 0;
+    for (const Posting& posting : terms[order[0]].postings) {
+        if (!segment.IsDeleted(posting.doc_id)) {
+            docs.push_back(posting.doc_id);
+            terms[order[0]].hits.push_back({index, posting.tf});
+        }
+        ++index;
+    }
+
+    // Doc-level intersection; blocks ending before the next candidate are
+    // skipped without decoding.
+    for (size_t k = 1; k < order.size() && !docs.empty(); ++k) {
+        Term& term = terms[order[k]];
+        term.hits.resize(docs.size());
+
+        size_t kept = 0;
+        IntersectPostings(term.postings, docs.data(), docs.size(), [&](size_t c, uint32_t index, uint32_t tf) {
+            docs[kept] = docs[c];
+            for (size_t previous = 0; previous < k; ++previous) {
+                terms[order[previous]].hits[kept] = terms[order[previous]].hits[c];
+            }
+            term.hits[kept] = {index, tf};
+            ++kept;
         });
 
+        docs.resize(kept);
+        for (size_t previous = 0; previous <= k; ++previous) terms[order[previous]].hits.resize(kept);
+    }
+
+    // Phrase slots by term, for repeated words
+    std::vector<size_t> slot_terms;
+    for (const auto& word : clause.words) {
+        slot_terms.push_back(std::lower_bound(words.begin(), words.end(), word) - words.begin());
+    }
+
+    std::vector<RelativeIndex> ranked_docs;
+    std::vector<std::vector<uint32_t>> positions(terms.size());
+    for (size_t c = 0; c < docs.size(); ++c) {
+        size_t count;
+        if (!segment.segment->HasPositions()) {
+            count = 1;
+        } else {
+            for (size_t t = 0; t < terms.size(); ++t) {
+                terms[t].positions.Decode(terms[t].hits[c].index, terms[t].hits[c].tf, positions[t]);
+            }
+            count = clause.kind == Query::Node::Kind::Phrase ? CountPhrase(positions, slot_terms)
+                                                                   : CountNear(positions, clause.distance);
+        }
+        if (count > 0) ranked_docs.push_back({docs[c], static_cast<float>(count)});
+    }
+
     return ranked_docs;
 }
+
+void SearchServer::mergeRanks(std::vector<RelativeIndex>& ranked_docs, const std::vector<RelativeIndex>& more) {
+    if (more.empty()) return;
+
+    std::vector<RelativeIndex> merged;
+    merged.reserve(ranked_docs.size() + more.size());
+
+    auto doc = ranked_docs.begin();
+    for (const auto& other : more) {
+        while (doc != ranked_docs.end() && doc->doc_id < other.doc_id) merged.push_back(*doc++);
+        if (doc != ranked_docs.end() && doc->doc_id == other.doc_id) {
+            merged.push_back({other.doc_id, doc->rank + other.rank});
+            ++doc;
+        } else {
+            merged.push_back(other);
+        }
+    }
+    merged.insert(merged.end(), doc, ranked_docs.end());
+
+    ranked_docs.swap(merged);
+}
+
+void SearchServer::intersectRanks(std::vector<RelativeIndex>& ranked_docs, const std::vector<RelativeIndex>& more) {
+    auto doc_ids = DocIds(ranked_docs);
+    auto more_ids = DocIds(more);
+    std::vector<uint32_t> matches(std::min(doc_ids.size(), more_ids.size()));
+    std::vector<uint32_t> more_matches(matches.size());
+    size_t count = IntersectSorted(doc_ids.data(), doc_ids.size(), more_ids.data(), more_ids.size(),
+                                   matches.data(), more_matches.data());
+
+    for (size_t i = 0; i < count; ++i) {
+        const RelativeIndex& doc = ranked_docs[matches[i]];
+        ranked_docs[i] = {doc.doc_id, doc.rank + more[more_matches[i]].rank};
+    }
+    ranked_docs.resize(count);
+}
+
+void SearchServer::subtractDocs(std::vector<RelativeIndex>& ranked_docs, const std::vector<RelativeIndex>& excluded) {
+    auto doc_ids = DocIds(ranked_docs);
+    auto excluded_ids = DocIds(excluded);
+    std::vector<uint32_t> matches(std::min(doc_ids.size(), excluded_ids.size()));
+    std::vector<uint32_t> excluded_matches(matches.size());
+    size_t count = IntersectSorted(doc_ids.data(), doc_ids.size(), excluded_ids.data(), excluded_ids.size(),
+                                   matches.data(), excluded_matches.data());
+
+    size_t kept = 0;
+    size_t from = 0;
+    for (size_t i = 0; i < count; ++i) {
+        while (from < matches[i]) ranked_docs[kept++] = ranked_docs[from++];
+        from = matches[i] + 1;
+    }
+    while (from < ranked_docs.size()) ranked_docs[kept++] = ranked_docs[from++];
+    ranked_docs.resize(kept);
+}
+
+void SearchServer::normalizeRanks(std::vector<RelativeIndex>& ranked_docs) {
+    if (ranked_docs.empty()) return;
+
+    float max_rank = ranked_docs.front().rank;
+    for (auto& doc : ranked_docs) {
+        doc.rank = max_rank > 0 ? doc.rank / max_rank : 0;
+    }
+}
@@ -0,0 +1,495 @@
+#include "Segment.h"
+#include "Checksum.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'E', 'S', 'E', 'G', 'M', 'N', 'T'};
+constexpr size_t kHeaderSize = 80;
+constexpr size_t kTermEntrySize = 32;
+constexpr size_t kDocumentEntrySize = 48;
+
+// Header field offsets
+constexpr size_t kVersionAt = 8;
+constexpr size_t kHeaderCrcAt = 12;
+constexpr size_t kFileSizeAt = 16;
+constexpr size_t kTermCountAt = 24;
+constexpr size_t kDocCountAt = 32;
+constexpr size_t kTermTableAt = 40;
+constexpr size_t kDocTableAt = 48;
+constexpr size_t kBodyCrcAt = 56;
+constexpr size_t kFlagsAt = 60;
+constexpr size_t kTermFilterAt = 64;
+constexpr size_t kTermFilterSizeAt = 72;
+
+constexpr uint32_t kHasPositions = 1;
+
+template <typename T>
+T Load(const uint8_t* at) {
+    T value;
+    std::memcpy(&value, at, sizeof(T));
+    return value;
+}
+
+template <typename T>
+void Store(uint8_t* at, T value) {
+    std::memcpy(at, &value, sizeof(T));
+}
+
+template <typename T>
+void Append(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+uint32_t HeaderCrc(const uint8_t* header) {
+    uint8_t copy[kHeaderSize];
+    std::memcpy(copy, header, kHeaderSize);
+    Store<uint32_t>(copy + kHeaderCrcAt, 0);
+    return Crc32c(0, copy, kHeaderSize);
+}
+
+[[noreturn]] void Corrupt(const std::string& name, const std::string& what) {
+    throw std::runtime_error("index segment " + name + ": " + what);
+}
+
+} // namespace
+
+std::shared_ptr<const Segment> Segment::Open(const std::string& path, bool verify_checksum) {
+    std::shared_ptr<Segment> segment(new Segment());
+    segment->file = MappedFile(path, MappedFile::Access::Random);
+    if (!segment->file.IsOpen()) Corrupt(path, "cannot open");
+
+    std::string_view data = segment->file.Data();
+    segment->base = reinterpret_cast<const uint8_t*>(data.data());
+    segment->size = data.size();
+    segment->Init(path, verify_checksum);
+    return segment;
+}
+
+void Segment::Init(const std::string& name, bool verify_checksum) {
+    const uint8_t* header = base;
+    if (size < kHeaderSize || std::memcmp(header, kMagic, sizeof(kMagic)) != 0) {
+        Corrupt(name, "not a segment file");
+    }
+    if (Load<uint32_t>(header + kVersionAt) != kVersion) {
+        Corrupt(name, "unsupported version " + std::to_string(Load<uint32_t>(header + kVersionAt)));
+    }
+    if (Load<uint32_t>(header + kHeaderCrcAt) != HeaderCrc(header)) {
+        Corrupt(name, "header checksum mismatch");
+    }
+    if (Load<uint64_t>(header + kFileSizeAt) != size) {
+        Corrupt(name, "truncated");
+    }
+
+    this->name = name;
+    term_count = Load<uint64_t>(header + kTermCountAt);
+    doc_count = Load<uint64_t>(header + kDocCountAt);
+    term_table_offset = Load<uint64_t>(header + kTermTableAt);
+    doc_table_offset = Load<uint64_t>(header + kDocTableAt);
+    body_crc = Load<uint32_t>(header + kBodyCrcAt);
+    has_positions = (Load<uint32_t>(header + kFlagsAt) & kHasPositions) != 0;
+    uint64_t filter_offset = Load<uint64_t>(header + kTermFilterAt);
+    uint64_t filter_size = Load<uint64_t>(header + kTermFilterSizeAt);
+
+    if (term_table_offset > size || term_count > (size - term_table_offset) / kTermEntrySize ||
+        doc_table_offset > size || doc_count > (size - doc_table_offset) / kDocumentEntrySize ||
+        filter_offset > size || filter_size > size - filter_offset ||
+        filter_size % TermFilter::kBlockBytes != 0) {
+        Corrupt(name, "section out of bounds");
+    }
+    term_filter = TermFilter::View(base + filter_offset, filter_size);
+
+    // Sections come in file order: postings, term table and strings,
+    // document table and paths, term filter. Every entry must point into
+    // its own section, so lookups never leave the file.
+    uint64_t term_table_end = term_table_offset + term_count * kTermEntrySize;
+    uint64_t doc_table_end = doc_table_offset + doc_count * kDocumentEntrySize;
+    if (term_table_offset < kHeaderSize || doc_table_offset < term_table_end || filter_offset < doc_table_end) {
+        Corrupt(name, "sections out of order");
+    }
+    for (size_t i = 0; i < term_count; ++i) {
+        TermEntry entry = ReadTermEntry(static_cast<uint32_t>(i));
+        if (entry.postings_offset < kHeaderSize || entry.postings_offset > term_table_offset ||
+            uint64_t(entry.postings_size) + entry.positions_size > term_table_offset - entry.postings_offset ||
+            entry.term_offset < term_table_end || entry.term_offset > doc_table_offset ||
+            entry.term_size > doc_table_offset - entry.term_offset) {
+            Corrupt(name, "term entry " + std::to_string(i) + " out of bounds");
+        }
+    }
+    for (size_t i = 0; i < doc_count; ++i) {
+        const uint8_t* at = base + doc_table_offset + i * kDocumentEntrySize;
+        uint64_t path_size = Load<uint32_t>(at + 4);
+        uint64_t path_offset = Load<uint64_t>(at + 8);
+        if (path_offset < doc_table_end || path_offset > filter_offset || path_size > filter_offset - path_offset) {
+            Corrupt(name, "document entry " + std::to_string(i) + " out of bounds");
+        }
+    }
+
+    if (verify_checksum && !VerifyChecksum()) {
+        Corrupt(name, "body checksum mismatch");
+    }
+    checked_terms.reset(new std::atomic<bool>[term_count]());
+}
+
+bool Segment::VerifyChecksum() const {
+    return Crc32c(0, base + kHeaderSize, size - kHeaderSize) == body_crc;
+}
+
+Segment::TermEntry Segment::ReadTermEntry(uint32_t term_id) const {
+    const uint8_t* at = base + term_table_offset + static_cast<size_t>(term_id) * kTermEntrySize;
+    return {Load<uint64_t>(at), Load<uint32_t>(at + 8), Load<uint32_t>(at + 12), Load<uint64_t>(at + 16),
+            Load<uint32_t>(at + 24)};
+}
+
+std::string_view Segment::Term(uint32_t term_id) const {
+    TermEntry entry = ReadTermEntry(term_id);
+    return {reinterpret_cast<const char*>(base + entry.term_offset), entry.term_size};
+}
+
+uint32_t Segment::FindTerm(std::string_view term) const {
+    if (!term_filter.MayContain(term)) return kNoTerm;
+
+    size_t low = 0;
+    size_t high = term_count;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (Term(static_cast<uint32_t>(middle)) < term) low = middle + 1;
+        else high = middle;
+    }
+    if (low < term_count && Term(static_cast<uint32_t>(low)) == term) {
+        return static_cast<uint32_t>(low);
+    }
+    return kNoTerm;
+}
+
+void Segment::CheckTerm(uint32_t term_id, const TermEntry& entry) const {
+    if (checked_terms[term_id].load(std::memory_order_acquire)) return;
+
+    PostingList postings = PostingList::View(base + entry.postings_offset, entry.postings_size);
+    PositionList positions = PositionList::View(base + entry.postings_offset + entry.postings_size,
+                                                entry.positions_size);
+    if (!postings.VerifyHeaders() ||
+        (has_positions && !positions.VerifyHeaders(postings.BlockCount()))) {
+        Corrupt(name, "postings of term " + std::to_string(term_id) + " out of bounds");
+    }
+    checked_terms[term_id].store(true, std::memory_order_release);
+}
+
+PostingList Segment::Postings(uint32_t term_id) const {
+    if (term_id >= term_count) return PostingList();
+
+    TermEntry entry = ReadTermEntry(term_id);
+    CheckTerm(term_id, entry);
+    return PostingList::View(base + entry.postings_offset, entry.postings_size);
+}
+
+PositionList Segment::Positions(uint32_t term_id) const {
+    if (term_id >= term_count || !has_positions) return PositionList();
+
+    TermEntry entry = ReadTermEntry(term_id);
+    CheckTerm(term_id, entry);
+    return PositionList::View(base + entry.postings_offset + entry.postings_size, entry.positions_size);
+}
+
+Segment::DocumentEntry Segment::Document(size_t index) const {
+    const uint8_t* at = base + doc_table_offset + index * kDocumentEntrySize;
+
+    DocumentEntry entry;
+    entry.doc_id = Load<uint32_t>(at);
+    uint32_t path_size = Load<uint32_t>(at + 4);
+    entry.path = {reinterpret_cast<const char*>(base + Load<uint64_t>(at + 8)), path_size};
+    entry.size = Load<uint64_t>(at + 16);
+    entry.mtime = Load<int64_t>(at + 24);
+    entry.content_hash = Load<uint64_t>(at + 32);
+    entry.exists = Load<uint32_t>(at + 40) != 0;
+    entry.deleted = Load<uint32_t>(at + 44) != 0;
+    return entry;
+}
+
+bool Segment::ContainsDocument(uint32_t doc_id) const {
+    size_t low = 0;
+    size_t high = doc_count;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (Load<uint32_t>(base + doc_table_offset + middle * kDocumentEntrySize) < doc_id) low = middle + 1;
+        else high = middle;
+    }
+    return low < doc_count && Load<uint32_t>(base + doc_table_offset + low * kDocumentEntrySize) == doc_id;
+}
+
+SegmentWriter::SegmentWriter(bool positions) : in_memory(true), positions(positions) {
+    buffer.assign(kHeaderSize, '\0');
+    offset = kHeaderSize;
+}
+
+SegmentWriter::SegmentWriter(const std::string& path, bool positions)
+    : in_memory(false),
+      positions(positions),
+      path(path),
+      temp_path(path + ".tmp"),
+      out(temp_path, std::ios::binary | std::ios::trunc) {
+    if (!out) throw std::runtime_error("Could not create " + temp_path);
+
+    // Placeholder, rewritten by Finish once the offsets are known
+    char header[kHeaderSize] = {};
+    out.write(header, kHeaderSize);
+    offset = kHeaderSize;
+}
+
+void SegmentWriter::Write(const void* data, size_t bytes) {
+    if (in_memory) {
+        buffer.append(static_cast<const char*>(data), bytes);
+    } else {
+        out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+    }
+    body_crc = Crc32c(body_crc, data, bytes);
+    offset += bytes;
+}
+
+void SegmentWriter::Pad(size_t alignment) {
+    static const char zeros[8] = {};
+    Write(zeros, (alignment - offset % alignment) % alignment);
+}
+
+void SegmentWriter::AddTermEntry(std::string_view term, size_t postings_size, size_t positions_size) {
+    if (term_count > 0 && term <= last_term) {
+        throw std::logic_error("SegmentWriter::AddTerm: terms must be added in ascending order");
+    }
+    last_term.assign(term);
+    term_hashes.push_back(TermFilter::Hash(term));
+
+    Append<uint64_t>(term_table, offset);
+    Append<uint32_t>(term_table, static_cast<uint32_t>(postings_size));
+    Append<uint32_t>(term_table, static_cast<uint32_t>(term.size()));
+    // Relative to the strings section for now; fixed up in Finish
+    Append<uint64_t>(term_table, term_strings.size());
+    Append<uint32_t>(term_table, static_cast<uint32_t>(positions_size));
+    Append<uint32_t>(term_table, 0);
+    term_strings.append(term);
+    ++term_count;
+}
+
+void SegmentWriter::AddTerm(std::string_view term, const PostingList& postings, const PositionList& term_positions) {
+    if (positions && term_positions.empty() && !postings.empty()) {
+        throw std::logic_error("SegmentWriter::AddTerm: positions missing");
+    }
+    if (!positions && !term_positions.empty()) {
+        throw std::logic_error("SegmentWriter::AddTerm: segment has no positions");
+    }
+    AddTermEntry(term, postings.ByteSize(), term_positions.ByteSize());
+
+    Write(postings.Bytes(), postings.ByteSize());
+    Write(term_positions.Bytes(), term_positions.ByteSize());
+}
+
+// Encoded section of a streamed term: in memory up to a limit, continued
+// in a scratch file beyond it
+class SegmentWriter::TermBuffer {
+public:
+    TermBuffer(std::string scratch_path, size_t limit)
+        : scratch_path(std::move(scratch_path)), limit(limit) {}
+
+    ~TermBuffer() {
+        if (!scratch.is_open()) return;
+        scratch.close();
+        std::error_code ec;
+        std::filesystem::remove(scratch_path, ec);
+    }
+
+    void Append(const uint8_t* data, size_t size) {
+        if (memory.size() + size > limit) {
+            if (!scratch.is_open()) {
+                scratch.open(scratch_path, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+                if (!scratch) throw std::runtime_error("Could not create " + scratch_path);
+            }
+            scratch.seekp(static_cast<std::streamoff>(scratch_bytes));
+            scratch.write(memory.data(), static_cast<std::streamsize>(memory.size()));
+            if (!scratch) throw std::runtime_error("Could not write " + scratch_path);
+            scratch_bytes += memory.size();
+            memory.clear();
+        }
+        memory.append(reinterpret_cast<const char*>(data), size);
+    }
+
+    size_t Size() const { return scratch_bytes + memory.size(); }
+
+    // Writes the section to writer and empties the buffer
+    void Drain(SegmentWriter& writer) {
+        if (scratch_bytes > 0) {
+            std::vector<char> chunk(std::min<size_t>(scratch_bytes, 1 << 16));
+            scratch.flush();
+            scratch.seekg(0);
+            for (size_t remaining = scratch_bytes; remaining > 0;) {
+                size_t n = std::min(remaining, chunk.size());
+                scratch.read(chunk.data(), static_cast<std::streamsize>(n));
+                if (!scratch) throw std::runtime_error("Could not read " + scratch_path);
+                writer.Write(chunk.data(), n);
+                remaining -= n;
+            }
+            scratch_bytes = 0;
+        }
+        writer.Write(memory.data(), memory.size());
+        memory.clear();
+    }
+
+private:
+    std::string scratch_path;
+    size_t limit;
+    std::string memory;
+    std::fstream scratch;
+    size_t scratch_bytes = 0;
+};
+
+SegmentWriter::~SegmentWriter() = default;
+
+void SegmentWriter::BeginTerm(std::string_view term) {
+    if (postings_encoder) throw std::logic_error("SegmentWriter::BeginTerm: previous term not ended");
+    if (term_count > 0 && term <= last_term) {
+        throw std::logic_error("SegmentWriter::BeginTerm: terms must be added in ascending order");
+    }
+    if (!streamed_postings) {
+        // An in-memory segment is held in memory anyway.
+        size_t limit = in_memory ? std::numeric_limits<size_t>::max() : kTermBufferBytes;
+        streamed_postings = std::make_unique<TermBuffer>(temp_path + ".postings", limit);
+        streamed_positions = std::make_unique<TermBuffer>(temp_path + ".positions", limit);
+    }
+
+    streamed_term.assign(term);
+    postings_encoder.emplace([this](const uint8_t* data, size_t size) { streamed_postings->Append(data, size); });
+    if (positions) {
+        positions_encoder.emplace([this](const uint8_t* data, size_t size) { streamed_positions->Append(data, size); });
+    }
+}
+
+void SegmentWriter::AddPosting(const Posting& posting, const uint32_t* term_positions) {
+    if (!postings_encoder) throw std::logic_error("SegmentWriter::AddPosting: no term begun");
+    if (positions && !term_positions) {
+        throw std::logic_error("SegmentWriter::AddPosting: positions missing");
+    }
+    if (!positions && term_positions) {
+        throw std::logic_error("SegmentWriter::AddPosting: segment has no positions");
+    }
+
+    postings_encoder->Add(posting);
+    if (positions) positions_encoder->Add(term_positions, posting.tf);
+}
+
+size_t SegmentWriter::EndTerm() {
+    if (!postings_encoder) throw std::logic_error("SegmentWriter::EndTerm: no term begun");
+
+    if (postings_encoder->size() == 0) {
+        postings_encoder.reset();
+        positions_encoder.reset();
+        return 0;
+    }
+
+    std::vector<uint8_t> postings_header = postings_encoder->Finish();
+    std::vector<uint8_t> positions_header;
+    if (positions) positions_header = positions_encoder->Finish();
+    postings_encoder.reset();
+    positions_encoder.reset();
+
+    size_t postings_size = postings_header.size() + streamed_postings->Size();
+    size_t positions_size = positions ? positions_header.size() + streamed_positions->Size() : 0;
+    AddTermEntry(streamed_term, postings_size, positions_size);
+
+    Write(postings_header.data(), postings_header.size());
+    streamed_postings->Drain(*this);
+    if (positions) {
+        Write(positions_header.data(), positions_header.size());
+        streamed_positions->Drain(*this);
+    }
+    return postings_size + positions_size;
+}
+
+void SegmentWriter::AddDocument(uint32_t doc_id, bool exists, std::string_view path, uint64_t size,
+                                int64_t mtime, uint64_t content_hash, bool deleted) {
+    if (document_count > 0 && doc_id <= last_doc_id) {
+        throw std::logic_error("SegmentWriter::AddDocument: documents must be added in doc_id order");
+    }
+    last_doc_id = doc_id;
+
+    Append<uint32_t>(document_table, doc_id);
+    Append<uint32_t>(document_table, static_cast<uint32_t>(path.size()));
+    // Relative to the paths section for now; fixed up in Finish
+    Append<uint64_t>(document_table, document_paths.size());
+    Append<uint64_t>(document_table, size);
+    Append<int64_t>(document_table, mtime);
+    Append<uint64_t>(document_table, content_hash);
+    Append<uint32_t>(document_table, exists ? 1 : 0);
+    Append<uint32_t>(document_table, deleted ? 1 : 0);
+    document_paths.append(path);
+    ++document_count;
+}
+
+std::shared_ptr<const Segment> SegmentWriter::Finish() {
+    // Removes the scratch files, if any
+    streamed_postings.reset();
+    streamed_positions.reset();
+
+    // Term table, then the strings it points to
+    Pad(8);
+    uint64_t term_table_offset = offset;
+    uint64_t strings_offset = term_table_offset + term_table.size();
+    for (size_t i = 0; i < term_count; ++i) {
+        auto* entry = reinterpret_cast<uint8_t*>(term_table.data()) + i * kTermEntrySize;
+        Store<uint64_t>(entry + 16, Load<uint64_t>(entry + 16) + strings_offset);
+    }
+    Write(term_table.data(), term_table.size());
+    Write(term_strings.data(), term_strings.size());
+
+    // Document table, then the paths
+    Pad(8);
+    uint64_t doc_table_offset = offset;
+    uint64_t paths_offset = doc_table_offset + document_table.size();
+    for (size_t i = 0; i < document_count; ++i) {
+        auto* entry = reinterpret_cast<uint8_t*>(document_table.data()) + i * kDocumentEntrySize;
+        Store<uint64_t>(entry + 8, Load<uint64_t>(entry + 8) + paths_offset);
+    }
+    Write(document_table.data(), document_table.size());
+    Write(document_paths.data(), document_paths.size());
+
+    Pad(8);
+    uint64_t filter_offset = offset;
+    TermFilter filter(term_hashes);
+    Write(filter.Bytes(), filter.ByteSize());
+
+    uint8_t header[kHeaderSize] = {};
+    std::memcpy(header, kMagic, sizeof(kMagic));
+    Store<uint32_t>(header + kVersionAt, Segment::kVersion);
+    Store<uint64_t>(header + kFileSizeAt, offset);
+    Store<uint64_t>(header + kTermCountAt, term_count);
+    Store<uint64_t>(header + kDocCountAt, document_count);
+    Store<uint64_t>(header + kTermTableAt, term_table_offset);
+    Store<uint64_t>(header + kDocTableAt, doc_table_offset);
+    Store<uint32_t>(header + kBodyCrcAt, body_crc);
+    Store<uint32_t>(header + kFlagsAt, positions ? kHasPositions : 0);
+    Store<uint64_t>(header + kTermFilterAt, filter_offset);
+    Store<uint64_t>(header + kTermFilterSizeAt, filter.ByteSize());
+    Store<uint32_t>(header + kHeaderCrcAt, HeaderCrc(header));
+
+    if (in_memory) {
+        std::memcpy(buffer.data(), header, kHeaderSize);
+
+        std::shared_ptr<Segment> segment(new Segment());
+        segment->memory = std::move(buffer);
+        segment->base = reinterpret_cast<const uint8_t*>(segment->memory.data());
+        segment->size = segment->memory.size();
+        segment->Init("(memory)", false);
+        return segment;
+    }
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(header), kHeaderSize);
+    out.close();
+    if (!out) throw std::runtime_error("Could not write " + temp_path);
+
+    std::filesystem::rename(temp_path, path);
+    return Segment::Open(path);
+}
@@ -0,0 +1,82 @@
+#include "TermFilter.h"
+
+#include <cstring>
+#include <utility>
+
+// Bit positions within a block, 9 bits each, from a remix of the hash
+// whose high half picked the block
+static uint64_t ProbeBits(uint64_t hash) {
+    return hash * 0x9e3779b97f4a7c15ull;
+}
+
+static size_t BlockOf(uint64_t hash, size_t block_count) {
+    return static_cast<size_t>(((hash >> 32) * block_count) >> 32);
+}
+
+uint64_t TermFilter::Hash(std::string_view term) {
+    // 64-bit FNV-1a with the murmur3 finalizer, as FNV alone mixes the
+    // last bytes poorly into the high bits
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : term) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+TermFilter::TermFilter(const std::vector<uint64_t>& hashes) {
+    size_t block_count = (hashes.size() * kBitsPerTerm + kBlockBytes * 8 - 1) / (kBlockBytes * 8);
+    if (block_count == 0) block_count = 1;
+
+    owned.assign(block_count * kBlockBytes, 0);
+    for (uint64_t hash : hashes) {
+        uint8_t* block = owned.data() + BlockOf(hash, block_count) * kBlockBytes;
+        uint64_t bits = ProbeBits(hash);
+        for (unsigned probe = 0; probe < kProbes; ++probe, bits >>= 9) {
+            unsigned bit = bits & 511;
+            block[bit / 8] |= static_cast<uint8_t>(1u << (bit % 8));
+        }
+    }
+    bytes = owned.data();
+    byte_size = owned.size();
+}
+
+TermFilter TermFilter::View(const uint8_t* bytes, size_t size) {
+    TermFilter filter;
+    if (size > 0) {
+        filter.bytes = bytes;
+        filter.byte_size = size;
+    }
+    return filter;
+}
+
+TermFilter::TermFilter(TermFilter&& other) noexcept {
+    *this = std::move(other);
+}
+
+TermFilter& TermFilter::operator=(TermFilter&& other) noexcept {
+    if (this == &other) return *this;
+
+    owned = std::move(other.owned);
+    bytes = std::exchange(other.bytes, nullptr);
+    byte_size = std::exchange(other.byte_size, 0);
+    other.owned.clear();
+    return *this;
+}
+
+bool TermFilter::MayContain(uint64_t hash) const {
+    if (byte_size == 0) return true;
+
+    const uint8_t* block = bytes + BlockOf(hash, byte_size / kBlockBytes) * kBlockBytes;
+    uint64_t bits = ProbeBits(hash);
+    for (unsigned probe = 0; probe < kProbes; ++probe, bits >>= 9) {
+        unsigned bit = bits & 511;
+        if ((block[bit / 8] & (1u << (bit % 8))) == 0) return false;
+    }
+    return true;
+}
@@ -0,0 +1,172 @@
+#include "TextKernel.h"
+
+#include <array>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define TEXT_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+struct ByteTables {
+    std::array<uint8_t, 256> is_word{};
+    std::array<char, 256> fold{};
+
+    ByteTables() {
+        for (int c = 0; c < 256; ++c) {
+            bool alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+            bool digit = c >= '0' && c <= '9';
+            is_word[c] = alpha || digit || c >= 0x80;
+            fold[c] = static_cast<char>((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c);
+        }
+    }
+};
+
+const ByteTables& Tables() {
+    static const ByteTables tables;
+    return tables;
+}
+
+// Handles text[begin, size) one byte at a time; begin is a multiple of 64.
+void ClassifyAndFoldScalar(const char* text, size_t begin, size_t size,
+                           char* folded, uint64_t* word_mask) {
+    const ByteTables& tables = Tables();
+
+    for (size_t block = begin; block < size; block += 64) {
+        size_t end = block + 64 < size ? block + 64 : size;
+        uint64_t mask = 0;
+        for (size_t i = block; i < end; ++i) {
+            auto c = static_cast<unsigned char>(text[i]);
+            folded[i] = tables.fold[c];
+            mask |= static_cast<uint64_t>(tables.is_word[c]) << (i - block);
+        }
+        word_mask[block / 64] = mask;
+    }
+}
+
+#ifdef TEXT_KERNEL_X86
+
+// Classifies and folds 16 bytes; returns the word byte mask.
+__attribute__((target("sse2")))
+inline uint32_t ClassifyAndFold16(const char* text, char* folded) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text));
+
+    // Bytes >= 0x80 are negative as signed chars.
+    __m128i high = _mm_cmplt_epi8(v, _mm_setzero_si128());
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                  _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                  _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+    __m128i word = _mm_or_si128(high, _mm_or_si128(alpha, digit));
+
+    // Only letters below 'a' are upper case.
+    __m128i upper = _mm_and_si128(alpha, _mm_cmplt_epi8(v, _mm_set1_epi8('a')));
+    __m128i result = _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(folded), result);
+
+    return static_cast<uint32_t>(_mm_movemask_epi8(word));
+}
+
+__attribute__((target("sse2")))
+void ClassifyAndFoldSSE2(const char* text, size_t size, char* folded, uint64_t* word_mask) {
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        uint64_t mask = ClassifyAndFold16(text + i, folded + i);
+        mask |= static_cast<uint64_t>(ClassifyAndFold16(text + i + 16, folded + i + 16)) << 16;
+        mask |= static_cast<uint64_t>(ClassifyAndFold16(text + i + 32, folded + i + 32)) << 32;
+        mask |= static_cast<uint64_t>(ClassifyAndFold16(text + i + 48, folded + i + 48)) << 48;
+        word_mask[i / 64] = mask;
+    }
+    ClassifyAndFoldScalar(text, i, size, folded, word_mask);
+}
+
+__attribute__((target("avx2")))
+inline uint32_t ClassifyAndFold32(const char* text, char* folded) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text));
+
+    __m256i high = _mm256_cmpgt_epi8(_mm256_setzero_si256(), v);
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+    __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+    __m256i word = _mm256_or_si256(high, _mm256_or_si256(alpha, digit));
+
+    __m256i upper = _mm256_and_si256(alpha, _mm256_cmpgt_epi8(_mm256_set1_epi8('a'), v));
+    __m256i result = _mm256_or_si256(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(folded), result);
+
+    return static_cast<uint32_t>(_mm256_movemask_epi8(word));
+}
+
+__attribute__((target("avx2")))
+void ClassifyAndFoldAVX2(const char* text, size_t size, char* folded, uint64_t* word_mask) {
+    size_t i = 0;
+    for (; i + 64 <= size; i += 64) {
+        uint64_t mask = ClassifyAndFold32(text + i, folded + i);
+        mask |= static_cast<uint64_t>(ClassifyAndFold32(text + i + 32, folded + i + 32)) << 32;
+        word_mask[i / 64] = mask;
+    }
+    ClassifyAndFoldScalar(text, i, size, folded, word_mask);
+}
+
+#endif // TEXT_KERNEL_X86
+
+bool IsSupported(TextKernelIsa isa) {
+    switch (isa) {
+    case TextKernelIsa::Scalar:
+        return true;
+#ifdef TEXT_KERNEL_X86
+    case TextKernelIsa::SSE2:
+        return __builtin_cpu_supports("sse2");
+    case TextKernelIsa::AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+TextKernelIsa DetectTextKernelIsa() {
+    static const TextKernelIsa detected = [] {
+        if (IsSupported(TextKernelIsa::AVX2)) return TextKernelIsa::AVX2;
+        if (IsSupported(TextKernelIsa::SSE2)) return TextKernelIsa::SSE2;
+        return TextKernelIsa::Scalar;
+    }();
+    return detected;
+}
+
+const char* TextKernelIsaName(TextKernelIsa isa) {
+    switch (isa) {
+    case TextKernelIsa::AVX2: return "avx2";
+    case TextKernelIsa::SSE2: return "sse2";
+    default: return "scalar";
+    }
+}
+
+void ClassifyAndFold(const char* text, size_t size, char* folded, uint64_t* word_mask) {
+    ClassifyAndFold(DetectTextKernelIsa(), text, size, folded, word_mask);
+}
+
+void ClassifyAndFold(TextKernelIsa isa, const char* text, size_t size,
+                     char* folded, uint64_t* word_mask) {
+    if (!IsSupported(isa)) isa = DetectTextKernelIsa();
+
+    switch (isa) {
+#ifdef TEXT_KERNEL_X86
+    case TextKernelIsa::AVX2:
+        ClassifyAndFoldAVX2(text, size, folded, word_mask);
+        return;
+    case TextKernelIsa::SSE2:
+        ClassifyAndFoldSSE2(text, size, folded, word_mask);
+        return;
+#endif
+    default:
+        ClassifyAndFoldScalar(text, 0, size, folded, word_mask);
+        return;
+    }
+}
@@ -0,0 +1,133 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    workers.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    task_available.notify_all();
+
+    for (auto& worker : workers) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        tasks.push(std::move(task));
+        ++pending_tasks;
+    }
+    task_available.notify_one();
+}
+
+void ThreadPool::Wait() {
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    tasks_done.wait(lock, [this] { return pending_tasks == 0; });
+
+    if (first_error) {
+        auto error = first_error;
+        first_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t batch_size,
+                             const std::function<void(size_t, size_t)>& body) {
+    batch_size = std::max<size_t>(batch_size, 1);
+
+    for (size_t begin = 0; begin < count; begin += batch_size) {
+        size_t end = std::min(count, begin + batch_size);
+        Submit([&body, begin, end] { body(begin, end); });
+    }
+    Wait();
+}
+
+void ThreadPool::ForEach(size_t count, const std::function<void(size_t)>& body) {
+    struct State {
+        std::atomic<size_t> next{0};
+        std::mutex mutex;
+        std::condition_variable idle;
+        // Helpers that joined before the items ran out
+        size_t active = 0;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>();
+
+    auto run = [state, count, &body] {
+        for (size_t i; (i = state->next.fetch_add(1)) < count;) {
+            try {
+                body(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (!state->error) state->error = std::current_exception();
+                state->next = count;
+            }
+        }
+    };
+
+    // Helpers queued behind other work may start after everything is
+    // done; they must not touch body then, which the caller no longer
+    // guarantees to be alive.
+    size_t helpers = std::min(Size(), count) - (count > 0 ? 1 : 0);
+    for (size_t h = 0; h < helpers; ++h) {
+        Submit([state, count, run] {
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (state->next.load() >= count) return;
+                ++state->active;
+            }
+            run();
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (--state->active == 0) state->idle.notify_all();
+        });
+    }
+
+    run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->idle.wait(lock, [&] { return state->active == 0; });
+    if (state->error) std::rethrow_exception(state->error);
+}
+
+void ThreadPool::WorkerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            task_available.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) return;
+
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            if (!first_error) first_error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            --pending_tasks;
+            if (pending_tasks == 0) tasks_done.notify_all();
+        }
+    }
+}
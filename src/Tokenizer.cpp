@@ -0,0 +1,37 @@
+#include "Tokenizer.h"
+#include "Bits.h"
+
+Tokenizer::Tokenizer(std::string_view text, TextKernelIsa isa)
+    : folded(new char[text.size()]),
+      size(text.size()),
+      word_mask((text.size() + 63) / 64) {
+    ClassifyAndFold(isa, text.data(), size, folded.get(), word_mask.data());
+}
+
+bool Tokenizer::Next(std::string_view& token) {
+    size_t begin;
+    if (!NextBoundary(begin)) return false;
+
+    // A word running up to the very end of the text has no closing boundary.
+    size_t end;
+    if (!NextBoundary(end)) end = size;
+
+    token = std::string_view(folded.get() + begin, end - begin);
+    return true;
+}
+
+bool Tokenizer::NextBoundary(size_t& offset) {
+    while (boundaries == 0) {
+        if (block == word_mask.size()) return false;
+
+        // Bit i is set where byte i differs in class from byte i - 1; text
+        // starts in "separator" state, so boundaries alternate begin/end.
+        uint64_t mask = word_mask[block++];
+        boundaries = mask ^ ((mask << 1) | carry);
+        carry = mask >> 63;
+    }
+
+    offset = (block - 1) * 64 + CountTrailingZeros(boundaries);
+    boundaries &= boundaries - 1;
+    return true;
+}
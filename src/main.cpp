@@ -1,24 +1,49 @@
 #include "ConverterJSON.h"
 #include "InvertedIndex.h"
 #include "SearchServer.h"
+#include <filesystem>
 #include <iostream>
+#include <stdexcept>
 
 int main() {
     try {
         ConverterJSON converter;
         InvertedIndex index;
-        SearchServer server(index);
+        SearchServer server(index, converter.GetResponsesLimit(), converter.GetResultCacheBudget());
 
         std::cout << "Starting SearchEngine..." << std::endl;
 
+        std::string index_file = converter.GetIndexFile();
+        if (!index_file.empty() && std::filesystem::exists(index_file)) {
+            std::cout << "Loading index from " << index_file << "..." << std::endl;
+            try {
+                index.Load(index_file);
+            } catch (const std::runtime_error& e) {
+                // Rebuilt from the documents below and saved over the bad file
+                std::cerr << "Could not load index: " << e.what() << std::endl;
+            }
+        }
+        uint64_t loaded_generation = index.Generation();
+
         std::cout << "Indexing documents..." << std::endl;
         index.UpdateDocumentBase();
 
+        if (!index_file.empty() && index.Generation() != loaded_generation) {
+            std::cout << "Saving index to " << index_file << "..." << std::endl;
+            index.Save(index_file);
+        }
+
         std::cout << "Processing requests..." << std::endl;
         auto requests = converter.GetRequests();
 
         auto results = server.search(requests);
 
+        auto cache_stats = server.cacheStats();
+        if (cache_stats.hits > 0) {
+            std::cout << "Result cache: " << cache_stats.hits << " hits, "
+                      << cache_stats.misses << " misses" << std::endl;
+        }
+
         std::cout << "Saving results..." << std::endl;
 
         std::vector<std::vector<std::pair<int, float>>> converted_results;
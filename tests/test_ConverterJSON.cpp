@@ -144,6 +144,21 @@ TEST_F(ConverterJSONTest, ThrowsWhenConfigMissingRequiredSections) {
     EXPECT_THROW(converter.GetTextDocuments(), std::runtime_error);
 }
 
+TEST_F(ConverterJSONTest, GetResponsesLimitReadsMaxResponses) {
+    EXPECT_EQ(converter.GetResponsesLimit(), 5);
+
+    for (const char* limit : {"0", "-3", "2.5", "\"5\""}) {
+        auto mtime = fs::last_write_time("config.json");
+        std::ofstream config("config.json", std::ios::trunc);
+        config << R"({"config":{"name":"Test","version":"1.0","max_responses":)" << limit
+               << R"(},"files":["only.txt"]})";
+        config.close();
+        fs::last_write_time("config.json", mtime + std::chrono::seconds(1));
+
+        EXPECT_THROW(converter.GetResponsesLimit(), std::runtime_error) << limit;
+    }
+}
+
 TEST_F(ConverterJSONTest, PutAnswersHandlesEmptyInput) {
     converter.putAnswers({});
     ASSERT_TRUE(fs::exists("answers.json"));
@@ -155,3 +170,54 @@ TEST_F(ConverterJSONTest, PutAnswersHandlesEmptyInput) {
     EXPECT_TRUE(result.contains("answers"));
     EXPECT_TRUE(result["answers"].empty());
 }
+
+TEST_F(ConverterJSONTest, GetTextDocumentsReloadsRewrittenConfig) {
+    ASSERT_EQ(converter.GetTextDocuments().size(), 5);
+
+    auto mtime = fs::last_write_time("config.json");
+    std::ofstream config("config.json", std::ios::trunc);
+    config << R"({"config":{"name":"Test","version":"1.0","max_responses":5},"files":["only.txt"]})";
+    config.close();
+    fs::last_write_time("config.json", mtime + std::chrono::seconds(1));
+
+    auto documents = converter.GetTextDocuments();
+    ASSERT_EQ(documents.size(), 1);
+    EXPECT_EQ(documents[0], "only.txt");
+}
+
+TEST_F(ConverterJSONTest, OptionalIndexSettingsDefaultToOff) {
+    EXPECT_EQ(converter.GetIndexFile(), "");
+    EXPECT_EQ(converter.GetIndexMemoryBudget(), 0);
+    EXPECT_EQ(converter.GetIndexSpillDirectory(), "");
+    EXPECT_EQ(converter.GetResultCacheBudget(), 0);
+    EXPECT_EQ(converter.GetPostingCacheBudget(), 0);
+    EXPECT_FALSE(converter.GetIndexPositions());
+
+    auto mtime = fs::last_write_time("config.json");
+    std::ofstream config("config.json", std::ios::trunc);
+    config << R"({"config":{"name":"Test","version":"1.0","max_responses":5,)"
+           << R"("index_file":"index.seg","index_memory_mb":1.5,"index_spill_dir":"/var/tmp/search",)"
+           << R"("index_positions":true,"result_cache_mb":2,"posting_cache_mb":0.5},"files":["only.txt"]})";
+    config.close();
+    fs::last_write_time("config.json", mtime + std::chrono::seconds(1));
+
+    EXPECT_EQ(converter.GetIndexFile(), "index.seg");
+    EXPECT_EQ(converter.GetIndexMemoryBudget(), 3 * 512 * 1024);
+    EXPECT_EQ(converter.GetIndexSpillDirectory(), "/var/tmp/search");
+    EXPECT_EQ(converter.GetResultCacheBudget(), 2 * 1024 * 1024);
+    EXPECT_EQ(converter.GetPostingCacheBudget(), 512 * 1024);
+    EXPECT_TRUE(converter.GetIndexPositions());
+}
+
+TEST_F(ConverterJSONTest, NegativeMemorySettingsThrow) {
+    auto mtime = fs::last_write_time("config.json");
+    std::ofstream config("config.json", std::ios::trunc);
+    config << R"({"config":{"name":"Test","version":"1.0","max_responses":5,)"
+           << R"("index_memory_mb":-1,"result_cache_mb":-0.5,"posting_cache_mb":-2},"files":["only.txt"]})";
+    config.close();
+    fs::last_write_time("config.json", mtime + std::chrono::seconds(1));
+
+    EXPECT_THROW(converter.GetIndexMemoryBudget(), std::runtime_error);
+    EXPECT_THROW(converter.GetResultCacheBudget(), std::runtime_error);
+    EXPECT_THROW(converter.GetPostingCacheBudget(), std::runtime_error);
+}
@@ -0,0 +1,169 @@
+#include "ExternalSort.h"
+#include "InvertedIndex.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+// Drains the postings of the merger's current term, appending their
+// positions to positions if given
+static std::vector<Posting> ReadTerm(RunMerger& merger, std::vector<uint32_t>* positions = nullptr) {
+    std::vector<Posting> postings;
+    Posting posting;
+    std::vector<uint32_t> posting_positions;
+    while (merger.NextPosting(posting, posting_positions)) {
+        postings.push_back(posting);
+        if (positions) positions->insert(positions->end(), posting_positions.begin(), posting_positions.end());
+    }
+    return postings;
+}
+
+TEST(ExternalSortTest, RunRoundTrips) {
+    TempDirectory dir;
+    RunWriter writer(dir.File("run"));
+    writer.Add("apple", {{1, 2}, {4, 1}}, {3, 7, 0});
+    writer.Add("banana", {{3, 5}}, {1, 2, 3, 4, 5});
+    writer.Add("cherry", {{6, 1}}, {9});
+    writer.Finish();
+
+    RunReader reader(dir.File("run"));
+    ASSERT_TRUE(reader.Next());
+    EXPECT_EQ(reader.Term(), "apple");
+    ASSERT_TRUE(reader.NextPosting());
+    EXPECT_EQ(reader.Current(), (Posting{1, 2}));
+    EXPECT_EQ(reader.Positions(), (std::vector<uint32_t>{3, 7}));
+    ASSERT_TRUE(reader.NextPosting());
+    EXPECT_EQ(reader.Current(), (Posting{4, 1}));
+    EXPECT_EQ(reader.Positions(), (std::vector<uint32_t>{0}));
+    EXPECT_FALSE(reader.NextPosting());
+
+    // Unread postings are skipped.
+    ASSERT_TRUE(reader.Next());
+    EXPECT_EQ(reader.Term(), "banana");
+    ASSERT_TRUE(reader.Next());
+    EXPECT_EQ(reader.Term(), "cherry");
+    ASSERT_TRUE(reader.NextPosting());
+    EXPECT_EQ(reader.Current(), (Posting{6, 1}));
+    EXPECT_FALSE(reader.Next());
+}
+
+TEST(ExternalSortTest, MergerInterleavesRunsByTermAndDocId) {
+    TempDirectory dir;
+    {
+        RunWriter first(dir.File("first"));
+        first.Add("apple", {{5, 1}});
+        first.Add("cherry", {{5, 2}});
+        first.Finish();
+
+        RunWriter second(dir.File("second"));
+        second.Add("apple", {{1, 3}, {9, 1}});
+        second.Add("banana", {{2, 1}});
+        second.Finish();
+
+        RunWriter empty(dir.File("empty"));
+        empty.Finish();
+    }
+
+    RunMerger merger({dir.File("first"), dir.File("second"), dir.File("empty")});
+
+    ASSERT_TRUE(merger.NextTerm());
+    EXPECT_EQ(merger.Term(), "apple");
+    EXPECT_EQ(ReadTerm(merger), (std::vector<Posting>{{1, 3}, {5, 1}, {9, 1}}));
+    // A term left unread is skipped.
+    ASSERT_TRUE(merger.NextTerm());
+    EXPECT_EQ(merger.Term(), "banana");
+    ASSERT_TRUE(merger.NextTerm());
+    EXPECT_EQ(merger.Term(), "cherry");
+    EXPECT_EQ(ReadTerm(merger), (std::vector<Posting>{{5, 2}}));
+    EXPECT_FALSE(merger.NextTerm());
+}
+
+TEST(ExternalSortTest, MergerKeepsPositionsWithTheirPostings) {
+    TempDirectory dir;
+    {
+        RunWriter first(dir.File("first"));
+        first.Add("apple", {{5, 2}}, {3, 8});
+        first.Finish();
+
+        RunWriter second(dir.File("second"));
+        second.Add("apple", {{1, 1}, {9, 3}}, {0, 1, 4, 6});
+        second.Finish();
+    }
+
+    RunMerger merger({dir.File("first"), dir.File("second")});
+    std::vector<uint32_t> positions;
+
+    ASSERT_TRUE(merger.NextTerm());
+    EXPECT_EQ(ReadTerm(merger, &positions), (std::vector<Posting>{{1, 1}, {5, 2}, {9, 3}}));
+    EXPECT_EQ(positions, (std::vector<uint32_t>{0, 3, 8, 1, 4, 6}));
+    EXPECT_FALSE(merger.NextTerm());
+}
+
+TEST(ExternalSortTest, TempDirectoryIsRemoved) {
+    std::string file;
+    {
+        TempDirectory dir;
+        file = dir.File("leftover");
+        std::ofstream(file) << "x";
+        EXPECT_TRUE(fs::exists(file));
+    }
+    EXPECT_FALSE(fs::exists(fs::path(file).parent_path()));
+
+    // A configured parent is created if missing and left in place.
+    {
+        TempDirectory dir("external_sort_spill/nested");
+        file = dir.File("leftover");
+        std::ofstream(file) << "x";
+        EXPECT_EQ(fs::path(file).parent_path().parent_path(), fs::path("external_sort_spill/nested"));
+    }
+    EXPECT_FALSE(fs::exists(fs::path(file).parent_path()));
+    EXPECT_TRUE(fs::exists("external_sort_spill/nested"));
+    fs::remove_all("external_sort_spill");
+}
+
+TEST(ExternalSortTest, BudgetedBuildMatchesInMemoryBuild) {
+    std::vector<std::string> files;
+    auto write_config = [&](const std::string& budget) {
+        std::ofstream config("config.json", std::ios::trunc);
+        config << R"({"config":{"name":"Test","version":"1.0","max_responses":5)" << budget << R"(},"files":[)";
+        for (size_t i = 0; i < files.size(); ++i) {
+            config << (i ? "," : "") << "\"" << files[i] << "\"";
+        }
+        config << "]}";
+    };
+
+    for (int i = 0; i < 30; ++i) {
+        files.push_back("external_sort_" + std::to_string(i) + ".txt");
+        std::ofstream(files.back()) << "shared word" << i << " shared term" << i % 7;
+    }
+
+    write_config("");
+    InvertedIndex in_memory(4);
+    in_memory.UpdateDocumentBase();
+
+    // Far below the corpus size: every document ends up in its own run.
+    write_config(R"(,"index_memory_mb":0.0001,"index_spill_dir":"external_sort_spill")");
+    InvertedIndex budgeted(4);
+    budgeted.UpdateDocumentBase();
+    // Runs and merged segments went there and are gone again.
+    EXPECT_TRUE(fs::is_empty("external_sort_spill"));
+
+    EXPECT_EQ(budgeted.GetWordCount("shared"), in_memory.GetWordCount("shared"));
+    EXPECT_EQ(budgeted.GetWordCount("shared").size(), files.size());
+    for (int i = 0; i < 30; ++i) {
+        EXPECT_EQ(budgeted.GetWordCount("word" + std::to_string(i)),
+                  in_memory.GetWordCount("word" + std::to_string(i)));
+    }
+    EXPECT_EQ(budgeted.GetWordCount("term3"), in_memory.GetWordCount("term3"));
+
+    // Incremental updates keep working on top of the spilled segment.
+    std::ofstream(files[3], std::ios::trunc) << "replaced";
+    budgeted.UpdateDocumentBase();
+    EXPECT_EQ(budgeted.GetWordCount("shared").size(), files.size() - 1);
+    EXPECT_EQ(budgeted.GetWordCount("replaced").at(3), 1);
+
+    for (const auto& file : files) fs::remove(file);
+    fs::remove("config.json");
+    fs::remove_all("external_sort_spill");
+}
@@ -0,0 +1,81 @@
+#include "Intersect.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+static const IntersectKernel kKernels[] = {
+    IntersectKernel::Merge, IntersectKernel::Gallop, IntersectKernel::SSE2, IntersectKernel::AVX2
+};
+
+// Sorted, unique values drawn from [0, range)
+static std::vector<uint32_t> RandomSet(std::mt19937& rng, size_t size, uint32_t range) {
+    std::uniform_int_distribution<uint32_t> value(0, range - 1);
+    std::vector<uint32_t> values;
+    while (values.size() < size) {
+        values.push_back(value(rng));
+        if (values.size() == size) {
+            std::sort(values.begin(), values.end());
+            values.erase(std::unique(values.begin(), values.end()), values.end());
+        }
+    }
+    return values;
+}
+
+static void ExpectIntersection(IntersectKernel kernel, const std::vector<uint32_t>& a,
+                               const std::vector<uint32_t>& b) {
+    std::vector<uint32_t> expected;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+
+    size_t capacity = std::min(a.size(), b.size());
+    std::vector<uint32_t> a_matches(capacity);
+    std::vector<uint32_t> b_matches(capacity);
+    size_t count = IntersectSorted(kernel, a.data(), a.size(), b.data(), b.size(),
+                                   a_matches.data(), b_matches.data());
+
+    ASSERT_EQ(count, expected.size()) << IntersectKernelName(kernel);
+    for (size_t i = 0; i < count; ++i) {
+        EXPECT_EQ(a[a_matches[i]], expected[i]) << IntersectKernelName(kernel);
+        EXPECT_EQ(b[b_matches[i]], expected[i]) << IntersectKernelName(kernel);
+    }
+}
+
+TEST(IntersectTest, KernelsAgreeWithSetIntersection) {
+    std::mt19937 rng(7);
+    for (size_t a_size : {0, 1, 3, 4, 7, 8, 9, 100, 1000}) {
+        for (size_t b_size : {0, 1, 5, 8, 16, 300, 5000}) {
+            for (uint32_t range : {20u, 2000u, 100000u}) {
+                auto a = RandomSet(rng, std::min<size_t>(a_size, range), range);
+                auto b = RandomSet(rng, std::min<size_t>(b_size, range), range);
+                for (IntersectKernel kernel : kKernels) {
+                    ExpectIntersection(kernel, a, b);
+                    ExpectIntersection(kernel, b, a);
+                }
+            }
+        }
+    }
+}
+
+TEST(IntersectTest, HandlesIdenticalDisjointAndExtremeValues) {
+    std::vector<uint32_t> evens;
+    std::vector<uint32_t> odds;
+    for (uint32_t i = 0; i < 200; ++i) {
+        evens.push_back(2 * i);
+        odds.push_back(2 * i + 1);
+    }
+    std::vector<uint32_t> extremes = {0, 1, 0x7fffffffu, 0x80000000u, 0xfffffffeu, 0xffffffffu};
+    std::vector<uint32_t> high = {1, 2, 3, 0x80000000u, 0x80000001u, 0xfffffff0u, 0xffffffffu};
+
+    for (IntersectKernel kernel : kKernels) {
+        ExpectIntersection(kernel, evens, evens);
+        ExpectIntersection(kernel, evens, odds);
+        ExpectIntersection(kernel, extremes, high);
+    }
+}
+
+TEST(IntersectTest, SkewedPairsGallop) {
+    EXPECT_EQ(ChooseIntersectKernel(10, 100000), IntersectKernel::Gallop);
+    EXPECT_EQ(ChooseIntersectKernel(100000, 10), IntersectKernel::Gallop);
+    EXPECT_EQ(ChooseIntersectKernel(0, 5), IntersectKernel::Gallop);
+    EXPECT_NE(ChooseIntersectKernel(1000, 2000), IntersectKernel::Gallop);
+}
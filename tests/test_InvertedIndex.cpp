@@ -3,6 +3,11 @@
 #include <gtest/gtest.h>
 #include <filesystem>
 #include <fstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
 
 namespace fs = std::filesystem;
 
@@ -167,3 +172,313 @@ TEST_F(InvertedIndexTest, ThreadSafety) {
         fs::remove(file);
     }
 }
+
+TEST_F(InvertedIndexTest, ResultDoesNotDependOnThreadCount) {
+    std::vector<std::string> many_files;
+    std::ofstream config("config.json", std::ios::trunc);
+    config << R"({"config":{"name":"Test","version":"1.0","max_responses":5},"files":[)";
+    for (int i = 0; i < 40; ++i) {
+        std::string filename = "partition_test_file_" + std::to_string(i) + ".txt";
+        std::ofstream file(filename);
+        file << "common word" << i << " common";
+        file.close();
+
+        if (i != 0) config << ",";
+        config << "\"" << filename << "\"";
+        many_files.push_back(filename);
+    }
+    config << "]}";
+    config.close();
+
+    InvertedIndex single(1);
+    InvertedIndex multi(8);
+    single.UpdateDocumentBase();
+    multi.UpdateDocumentBase();
+
+    EXPECT_EQ(single.GetWordCount("common"), multi.GetWordCount("common"));
+    EXPECT_EQ(multi.GetWordCount("common").size(), many_files.size());
+    for (size_t i = 0; i < many_files.size(); ++i) {
+        const auto& counts = multi.GetWordCount("word" + std::to_string(i));
+        ASSERT_EQ(counts.size(), 1);
+        EXPECT_EQ(counts.at(i), 1);
+        EXPECT_EQ(multi.GetWordCount("common").at(i), 2);
+    }
+
+    for (const auto& file : many_files) {
+        fs::remove(file);
+    }
+}
+
+TEST_F(InvertedIndexTest, GenerationAdvancesOnlyWhenIndexChanges) {
+    InvertedIndex index;
+    EXPECT_EQ(index.Generation(), 0);
+    EXPECT_TRUE(index.IsStale());
+
+    index.UpdateDocumentBase();
+    EXPECT_EQ(index.Generation(), 1);
+    EXPECT_FALSE(index.IsStale());
+
+    index.UpdateDocumentBase();
+    EXPECT_EQ(index.Generation(), 1);
+
+    std::ofstream(test_files[1], std::ios::app) << " again";
+    index.UpdateDocumentBase();
+    EXPECT_EQ(index.Generation(), 2);
+}
+
+TEST_F(InvertedIndexTest, RefreshOnlyRebuildsChangedCorpus) {
+    InvertedIndex index;
+    EXPECT_TRUE(index.Refresh());
+    EXPECT_FALSE(index.Refresh());
+    EXPECT_EQ(index.Generation(), 1);
+
+    std::ofstream(test_files[2], std::ios::app) << " refreshed";
+    EXPECT_TRUE(index.IsStale());
+    EXPECT_TRUE(index.Refresh());
+    EXPECT_EQ(index.Generation(), 2);
+    EXPECT_EQ(index.GetWordCount("refreshed").at(2), 1);
+}
+
+TEST_F(InvertedIndexTest, UpdateDocumentBaseReindexesModifiedDocumentOnly) {
+    InvertedIndex index;
+    index.UpdateDocumentBase();
+
+    std::ofstream(test_files[0], std::ios::trunc) << "goodbye world";
+    index.UpdateDocumentBase();
+
+    EXPECT_TRUE(index.GetWordCount("hello").empty());
+    EXPECT_EQ(index.GetWordCount("goodbye").at(0), 1);
+
+    const auto& world_counts = index.GetWordCount("world");
+    EXPECT_EQ(world_counts.size(), 2);
+    EXPECT_EQ(world_counts.at(0), 1);
+    EXPECT_EQ(world_counts.at(1), 1);
+    EXPECT_EQ(index.GetWordCount("test").at(2), 3);
+}
+
+TEST_F(InvertedIndexTest, UpdateDocumentBaseHandlesAddedAndRemovedDocuments) {
+    InvertedIndex index;
+    index.UpdateDocumentBase();
+
+    std::ofstream("test_file4.txt") << "brand new world";
+    test_files.push_back("test_file4.txt");
+
+    auto rewrite_config = [](const std::string& files) {
+        auto mtime = fs::last_write_time("config.json");
+        std::ofstream config("config.json", std::ios::trunc);
+        config << R"({"config":{"name":"Test","version":"1.0","max_responses":5},"files":[)" << files << "]}";
+        config.close();
+        fs::last_write_time("config.json", mtime + std::chrono::seconds(1));
+    };
+
+    rewrite_config(R"("test_file1.txt","test_file2.txt","test_file3.txt","test_file4.txt")");
+    index.UpdateDocumentBase();
+    EXPECT_EQ(index.GetWordCount("brand").at(3), 1);
+    EXPECT_EQ(index.GetWordCount("world").size(), 3);
+
+    rewrite_config(R"("test_file1.txt","test_file2.txt")");
+    index.UpdateDocumentBase();
+    EXPECT_TRUE(index.GetWordCount("brand").empty());
+    EXPECT_TRUE(index.GetWordCount("test").empty());
+    EXPECT_EQ(index.GetWordCount("world").size(), 2);
+    EXPECT_EQ(index.GetWordCount("hello").at(0), 2);
+}
+
+TEST_F(InvertedIndexTest, TouchedButUnmodifiedDocumentKeepsGeneration) {
+    InvertedIndex index;
+    index.UpdateDocumentBase();
+
+    fs::last_write_time(test_files[0], fs::last_write_time(test_files[0]) + std::chrono::seconds(5));
+    EXPECT_TRUE(index.IsStale());
+
+    index.UpdateDocumentBase();
+    EXPECT_EQ(index.Generation(), 1);
+    EXPECT_FALSE(index.IsStale());
+    EXPECT_EQ(index.GetWordCount("hello").at(0), 2);
+}
+
+TEST_F(InvertedIndexTest, UpdatesAddSegmentsAndDeleteOldVersions) {
+    TieredMergePolicy::Options options;
+    options.background = false;
+    options.segments_per_tier = 100;
+    options.max_deleted_fraction = 1;
+    InvertedIndex index(0, options);
+    index.UpdateDocumentBase();
+    ASSERT_EQ(index.GetSnapshot()->segments.size(), 1);
+    auto first = index.GetSnapshot()->segments[0].segment;
+
+    std::ofstream(test_files[0], std::ios::trunc) << "world peace";
+    index.UpdateDocumentBase();
+
+    // The old segment is untouched; doc 0 is only marked deleted in it.
+    auto segments = index.GetSnapshot()->segments;
+    ASSERT_EQ(segments.size(), 2);
+    EXPECT_EQ(segments[0].segment, first);
+    EXPECT_TRUE(segments[0].IsDeleted(0));
+    EXPECT_EQ(segments[0].deleted_count, 1);
+    EXPECT_FALSE(segments[1].IsDeleted(0));
+    EXPECT_EQ(segments[1].segment->DocumentCount(), 1);
+
+    EXPECT_TRUE(index.GetWordCount("hello").empty());
+    EXPECT_EQ(index.GetWordCount("world").size(), 2);
+    EXPECT_EQ(index.GetWordCount("peace").at(0), 1);
+}
+
+TEST_F(InvertedIndexTest, MergesCompactSegmentsAndDropDeletedPostings) {
+    TieredMergePolicy::Options options;
+    options.background = false;
+    options.segments_per_tier = 3;
+    InvertedIndex index(0, options);
+    index.UpdateDocumentBase();
+
+    std::ofstream(test_files[0], std::ios::trunc) << "first rewrite";
+    index.UpdateDocumentBase();
+    EXPECT_EQ(index.GetSnapshot()->segments.size(), 2);
+
+    std::ofstream(test_files[1], std::ios::trunc) << "second rewrite";
+    index.UpdateDocumentBase();
+
+    auto segments = index.GetSnapshot()->segments;
+    ASSERT_EQ(segments.size(), 1);
+    EXPECT_EQ(segments[0].deleted_count, 0);
+    EXPECT_EQ(segments[0].segment->DocumentCount(), 3);
+    EXPECT_EQ(segments[0].segment->FindTerm("world"), Segment::kNoTerm);
+    EXPECT_EQ(index.GetWordCount("rewrite").size(), 2);
+    EXPECT_EQ(index.GetWordCount("second").at(1), 1);
+    EXPECT_EQ(index.GetWordCount("test").at(2), 3);
+}
+
+TEST_F(InvertedIndexTest, BackgroundMergeKeepsResults) {
+    TieredMergePolicy::Options options;
+    options.segments_per_tier = 2;
+    InvertedIndex index(0, options);
+    index.UpdateDocumentBase();
+
+    for (int i = 0; i < 5; ++i) {
+        std::ofstream(test_files[1], std::ios::trunc) << "world of warcraft " << i;
+        fs::last_write_time(test_files[1], fs::last_write_time(test_files[1]) + std::chrono::seconds(i + 1));
+        index.UpdateDocumentBase();
+        EXPECT_EQ(index.GetWordCount("world").size(), 2);
+    }
+    index.WaitForMerges();
+
+    EXPECT_LE(index.GetSnapshot()->segments.size(), 2);
+    EXPECT_EQ(index.GetWordCount("hello").at(0), 2);
+    EXPECT_EQ(index.GetWordCount("4").at(1), 1);
+    EXPECT_TRUE(index.GetWordCount("3").empty());
+}
+
+TEST_F(InvertedIndexTest, UpdateDocumentReplacesOneDocument) {
+    InvertedIndex index;
+    index.UpdateDocumentBase();
+    uint64_t generation = index.Generation();
+
+    std::ofstream("test_file4.txt") << "replacement world";
+    test_files.push_back("test_file4.txt");
+    index.UpdateDocument(1, "test_file4.txt");
+
+    EXPECT_GT(index.Generation(), generation);
+    EXPECT_TRUE(index.GetWordCount("warcraft").empty());
+    EXPECT_EQ(index.GetWordCount("replacement").at(1), 1);
+    EXPECT_EQ(index.GetWordCount("world").size(), 2);
+
+    // New ids extend the document list.
+    index.UpdateDocument(5, "test_file4.txt");
+    EXPECT_EQ(index.GetWordCount("replacement").size(), 2);
+    EXPECT_EQ(index.GetWordCount("replacement").at(5), 1);
+}
+
+TEST_F(InvertedIndexTest, DeletionsPastThresholdArePurged) {
+    TieredMergePolicy::Options options;
+    options.background = false;
+    options.max_deleted_fraction = 0.5;
+    InvertedIndex index(0, options);
+    index.UpdateDocumentBase();
+
+    EXPECT_TRUE(index.DeleteDocument(0));
+    auto segments = index.GetSnapshot()->segments;
+    ASSERT_EQ(segments.size(), 1);
+    EXPECT_EQ(segments[0].deleted_count, 1);
+    EXPECT_TRUE(index.GetWordCount("hello").empty());
+
+    // Two of three deleted: the segment is rewritten without them.
+    EXPECT_TRUE(index.DeleteDocument(1));
+    segments = index.GetSnapshot()->segments;
+    ASSERT_EQ(segments.size(), 1);
+    EXPECT_EQ(segments[0].deleted_count, 0);
+    EXPECT_EQ(segments[0].segment->DocumentCount(), 1);
+    EXPECT_EQ(segments[0].segment->FindTerm("world"), Segment::kNoTerm);
+    EXPECT_EQ(index.GetWordCount("test").at(2), 3);
+
+    // Deleting the last document drops the segment.
+    EXPECT_TRUE(index.DeleteDocument(2));
+    EXPECT_TRUE(index.GetSnapshot()->segments.empty());
+}
+
+TEST_F(InvertedIndexTest, SnapshotOutlivesUpdates) {
+    InvertedIndex index;
+    index.UpdateDocumentBase();
+    auto before = index.GetSnapshot();
+    EXPECT_EQ(before->generation, index.Generation());
+
+    std::ofstream(test_files[0], std::ios::trunc) << "goodbye";
+    index.UpdateDocumentBase();
+    auto after = index.GetSnapshot();
+    EXPECT_EQ(after->generation, before->generation + 1);
+
+    auto find = [](const InvertedIndex::Snapshot& snapshot, const std::string& word) {
+        size_t live = 0;
+        for (const auto& segment : snapshot.segments) {
+            uint32_t term_id = segment.segment->FindTerm(word);
+            if (term_id == Segment::kNoTerm) continue;
+            for (const Posting& posting : segment.segment->Postings(term_id)) {
+                if (!segment.IsDeleted(posting.doc_id)) ++live;
+            }
+        }
+        return live;
+    };
+    EXPECT_EQ(find(*before, "hello"), 1);
+    EXPECT_EQ(find(*before, "goodbye"), 0);
+    EXPECT_EQ(find(*after, "hello"), 0);
+    EXPECT_EQ(find(*after, "goodbye"), 1);
+}
+
+TEST_F(InvertedIndexTest, AbsentTermsLastForOneSnapshot) {
+    InvertedIndex index;
+    index.UpdateDocumentBase();
+    auto before = index.GetSnapshot();
+    EXPECT_TRUE(before->HasTerm("hello"));
+    EXPECT_FALSE(before->HasTerm("goodbye"));
+    EXPECT_FALSE(before->HasTerm("goodbye"));
+    EXPECT_TRUE(index.GetWordCount("goodbye").empty());
+
+    // The next snapshot looks again.
+    std::ofstream(test_files[0], std::ios::trunc) << "goodbye";
+    index.UpdateDocumentBase();
+    EXPECT_FALSE(before->HasTerm("goodbye"));
+    EXPECT_TRUE(index.GetSnapshot()->HasTerm("goodbye"));
+    EXPECT_EQ(index.GetWordCount("goodbye").at(0), 1);
+}
+
+#ifndef _WIN32
+TEST_F(InvertedIndexTest, IndexesPipeOnEveryUpdate) {
+    fs::remove(test_files[2]);
+    ASSERT_EQ(mkfifo(test_files[2].c_str(), 0600), 0);
+
+    InvertedIndex index;
+    std::thread writer([&] { std::ofstream(test_files[2]) << "piped words piped"; });
+    index.UpdateDocumentBase();
+    writer.join();
+    EXPECT_EQ(index.GetWordCount("piped").at(2), 2);
+    EXPECT_TRUE(index.GetWordCount("test").empty());
+
+    // A pipe has no size or mtime to compare, so it is read again.
+    EXPECT_TRUE(index.IsStale());
+    writer = std::thread([&] { std::ofstream(test_files[2]) << "fresh words"; });
+    index.UpdateDocumentBase();
+    writer.join();
+    EXPECT_TRUE(index.GetWordCount("piped").empty());
+    EXPECT_EQ(index.GetWordCount("fresh").at(2), 1);
+    EXPECT_EQ(index.GetWordCount("hello").at(0), 2);
+}
+#endif
@@ -0,0 +1,58 @@
+#include "MergePolicy.h"
+#include <gtest/gtest.h>
+
+using SegmentInfo = TieredMergePolicy::SegmentInfo;
+
+// Segments without deletions
+static std::vector<SegmentInfo> Sizes(const std::vector<size_t>& bytes) {
+    std::vector<SegmentInfo> segments;
+    for (size_t size : bytes) segments.push_back({size, 10, 0});
+    return segments;
+}
+
+static TieredMergePolicy MakePolicy(size_t segments_per_tier, size_t floor_bytes) {
+    TieredMergePolicy::Options options;
+    options.segments_per_tier = segments_per_tier;
+    options.floor_segment_bytes = floor_bytes;
+    return TieredMergePolicy(options);
+}
+
+TEST(TieredMergePolicyTest, NothingToMergeBelowTierWidth) {
+    auto policy = MakePolicy(4, 100);
+    EXPECT_TRUE(policy.FindMerge(Sizes({})).empty());
+    EXPECT_TRUE(policy.FindMerge(Sizes({10, 20, 30})).empty());
+    // One segment per tier
+    EXPECT_TRUE(policy.FindMerge(Sizes({50, 300, 1000, 5000})).empty());
+}
+
+TEST(TieredMergePolicyTest, MergesSmallestSegmentsOfFullTier) {
+    auto policy = MakePolicy(3, 100);
+    EXPECT_EQ(policy.FindMerge(Sizes({5000, 10, 20, 90, 40})), (std::vector<size_t>{1, 2, 4}));
+}
+
+TEST(TieredMergePolicyTest, LowerTiersGoFirst) {
+    auto policy = MakePolicy(2, 100);
+    // Tier 1 (101..200) and tier 0 (<= 100) are both full.
+    EXPECT_EQ(policy.FindMerge(Sizes({150, 160, 30, 40})), (std::vector<size_t>{2, 3}));
+}
+
+TEST(TieredMergePolicyTest, PurgesSegmentWithMostDeletionsPastThreshold) {
+    auto policy = MakePolicy(10, 100);
+    std::vector<SegmentInfo> segments = {{1000, 10, 2}, {1000, 10, 4}, {1000, 10, 3}};
+    EXPECT_EQ(policy.FindMerge(segments), (std::vector<size_t>{1}));
+
+    segments = {{1000, 10, 2}, {1000, 10, 1}};
+    EXPECT_TRUE(policy.FindMerge(segments).empty());
+}
+
+TEST(MergeRateLimiterTest, UnlimitedNeverPauses) {
+    MergeRateLimiter limiter(0);
+    EXPECT_EQ(limiter.Account(1 << 30), std::chrono::steady_clock::duration::zero());
+}
+
+TEST(MergeRateLimiterTest, PausesWhenAheadOfRate) {
+    MergeRateLimiter limiter(1000);
+    auto pause = limiter.Account(1000);
+    EXPECT_GT(pause, std::chrono::milliseconds(900));
+    EXPECT_LE(pause, std::chrono::seconds(1));
+}
@@ -0,0 +1,65 @@
+#include "PositionList.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+TEST(PositionListTest, DecodesPositionsOfSinglePostings) {
+    std::vector<Posting> postings = {{0, 2}, {3, 1}, {7, 3}};
+    std::vector<uint32_t> positions = {4, 9, 0, 1, 2, 100000};
+    PositionList list(postings, positions);
+
+    std::vector<uint32_t> out;
+    list.Decode(0, 2, out);
+    EXPECT_EQ(out, (std::vector<uint32_t>{4, 9}));
+    list.Decode(2, 3, out);
+    EXPECT_EQ(out, (std::vector<uint32_t>{1, 2, 100000}));
+    list.Decode(1, 1, out);
+    EXPECT_EQ(out, (std::vector<uint32_t>{0}));
+}
+
+TEST(PositionListTest, RoundTripsAcrossManyBlocks) {
+    std::vector<Posting> postings;
+    std::vector<uint32_t> positions;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        uint32_t tf = 1 + i % 7;
+        postings.push_back({i * 3, tf});
+        for (uint32_t j = 0; j < tf; ++j) positions.push_back(i + j * (i % 50 + 1));
+    }
+
+    PositionList list(postings, positions);
+    PostingList encoded(postings);
+
+    std::vector<uint32_t> all;
+    uint32_t doc_ids[PostingList::kBlockSize];
+    uint32_t tfs[PostingList::kBlockSize];
+    for (size_t block = 0; block < encoded.BlockCount(); ++block) {
+        encoded.DecodeBlock(block, doc_ids, tfs);
+        list.DecodeBlock(block, tfs, encoded.BlockSize(block), all);
+    }
+    EXPECT_EQ(all, positions);
+
+    std::vector<uint32_t> out;
+    size_t start = 0;
+    for (size_t i = 0; i < postings.size(); start += postings[i].tf, ++i) {
+        list.Decode(i, postings[i].tf, out);
+        ASSERT_EQ(out, std::vector<uint32_t>(positions.begin() + start, positions.begin() + start + postings[i].tf));
+    }
+}
+
+TEST(PositionListTest, ViewSharesBytes) {
+    PositionList list({{1, 2}}, {3, 5});
+    PositionList view = PositionList::View(list.Bytes(), list.ByteSize());
+
+    std::vector<uint32_t> out;
+    view.Decode(0, 2, out);
+    EXPECT_EQ(out, (std::vector<uint32_t>{3, 5}));
+    EXPECT_TRUE(PositionList().empty());
+}
+
+TEST(PositionListTest, SortByDocIdMovesPositionsAlong) {
+    std::vector<Posting> postings = {{5, 1}, {2, 2}, {9, 1}};
+    std::vector<uint32_t> positions = {7, 1, 4, 0};
+
+    SortByDocId(postings, positions);
+    EXPECT_EQ(postings, (std::vector<Posting>{{2, 2}, {5, 1}, {9, 1}}));
+    EXPECT_EQ(positions, (std::vector<uint32_t>{1, 4, 7, 0}));
+}
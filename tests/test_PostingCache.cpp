@@ -0,0 +1,119 @@
+#include "PostingCache.h"
+#include "InvertedIndex.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// In-memory segment of term_count terms, each with postings postings
+static std::shared_ptr<const Segment> MakeSegment(size_t term_count, uint32_t postings) {
+    SegmentWriter writer;
+    for (size_t t = 0; t < term_count; ++t) {
+        std::vector<Posting> list;
+        for (uint32_t i = 0; i < postings; ++i) list.push_back({i * 3 + static_cast<uint32_t>(t), i % 5 + 1});
+        char term[32];
+        std::snprintf(term, sizeof(term), "term%04zu", t);
+        writer.AddTerm(term, PostingList(list));
+    }
+    return writer.Finish();
+}
+
+TEST(PostingCacheTest, AdmitsTermsOnTheirSecondRead) {
+    auto segment = MakeSegment(3, 1000);
+    PostingCache cache(1 << 20);
+
+    PostingList first = cache.Postings(segment, 1);
+    EXPECT_TRUE(first.IsView());
+    PostingList second = cache.Postings(segment, 1);
+    EXPECT_TRUE(second.IsDecoded());
+    PostingList third = cache.Postings(segment, 1);
+    EXPECT_TRUE(third.IsDecoded());
+    EXPECT_EQ(third.Bytes(), second.Bytes());
+
+    EXPECT_EQ(third, segment->Postings(1));
+    EXPECT_EQ(third.Decode(), segment->Postings(1).Decode());
+
+    auto stats = cache.GetStats();
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.entries, 1);
+    EXPECT_GE(stats.bytes, third.MemoryBytes());
+}
+
+TEST(PostingCacheTest, StaysWithinItsCapacity) {
+    auto segment = MakeSegment(50, 300);
+    size_t entry_bytes = segment->Postings(0).Decoded().MemoryBytes();
+    PostingCache cache(10 * entry_bytes, 1);
+
+    for (int round = 0; round < 3; ++round) {
+        for (uint32_t t = 0; t < 50; ++t) {
+            EXPECT_EQ(cache.Postings(segment, t), segment->Postings(t));
+            EXPECT_LE(cache.GetStats().bytes, 10 * entry_bytes);
+        }
+    }
+    EXPECT_GT(cache.GetStats().entries, 0);
+
+    cache.SetCapacity(0);
+    EXPECT_FALSE(cache.Enabled());
+    EXPECT_EQ(cache.GetStats().entries, 0);
+    EXPECT_TRUE(cache.Postings(segment, 0).IsView());
+}
+
+TEST(PostingCacheTest, NeverServesListsOfADroppedSegment) {
+    PostingCache cache(1 << 20);
+
+    // Segments freed and reallocated may reuse an address.
+    for (uint32_t postings = 100; postings < 110; ++postings) {
+        auto segment = MakeSegment(1, postings);
+        for (int read = 0; read < 3; ++read) {
+            EXPECT_EQ(cache.Postings(segment, 0).size(), postings);
+        }
+    }
+}
+
+TEST(PostingCacheTest, ConcurrentReaders) {
+    auto segment = MakeSegment(20, 500);
+    PostingCache cache(1 << 20, 4);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (uint32_t i = 0; i < 400; ++i) {
+                uint32_t term_id = i % 20;
+                EXPECT_EQ(cache.Postings(segment, term_id).size(), 500u);
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    auto stats = cache.GetStats();
+    EXPECT_EQ(stats.hits + stats.misses, 1600);
+    EXPECT_EQ(stats.entries, 20);
+}
+
+TEST(PostingCacheTest, IndexReadsHotTermsFromCache) {
+    std::ofstream("posting_cache_doc.txt") << "hot cold hot";
+    std::ofstream("config.json") << R"({
+        "config": {"name":"Test","version":"1.0","max_responses":5,"posting_cache_mb":1},
+        "files": ["posting_cache_doc.txt"]
+    })";
+
+    InvertedIndex index;
+    index.UpdateDocumentBase();
+    for (int read = 0; read < 3; ++read) {
+        auto postings = index.GetWordCount("hot");
+        ASSERT_EQ(postings.size(), 1);
+        EXPECT_EQ(postings.at(0), 2);
+    }
+    auto stats = index.PostingCacheStats();
+    EXPECT_EQ(stats.entries, 1);
+    EXPECT_EQ(stats.hits, 1);
+
+    fs::remove("posting_cache_doc.txt");
+    fs::remove("config.json");
+}
@@ -0,0 +1,83 @@
+#include "PostingCodec.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+TEST(PostingCodecTest, StreamVByteRoundTripsGaps) {
+    std::mt19937 rng(1);
+    std::vector<uint32_t> gaps;
+    for (int i = 0; i < 1001; ++i) {
+        // Mix of 1, 2, 3 and 4 byte values
+        int bytes = i % 4;
+        gaps.push_back(rng() >> (8 * (3 - bytes)) >> 1);
+    }
+
+    std::vector<uint8_t> encoded(StreamVByteMaxBytes(gaps.size()));
+    size_t bytes = EncodeStreamVByte(gaps.data(), gaps.size(), encoded.data());
+    encoded.resize(bytes);
+
+    std::vector<uint32_t> expected(gaps.size());
+    uint32_t sum = 5;
+    for (size_t i = 0; i < gaps.size(); ++i) expected[i] = sum += gaps[i];
+
+    std::vector<uint32_t> decoded(gaps.size());
+    const uint8_t* end = DecodeStreamVByteDeltas(encoded.data(), encoded.data() + encoded.size(),
+                                                 gaps.size(), 5, decoded.data());
+    EXPECT_EQ(end, encoded.data() + encoded.size());
+    EXPECT_EQ(decoded, expected);
+
+    std::vector<uint32_t> scalar(gaps.size());
+    DecodeStreamVByteDeltasScalar(encoded.data(), encoded.data() + encoded.size(),
+                                  gaps.size(), 5, scalar.data());
+    EXPECT_EQ(scalar, expected);
+}
+
+TEST(PostingCodecTest, StreamVByteStopsAtLimit) {
+    std::vector<uint32_t> gaps(100, 70000);
+    std::vector<uint8_t> encoded(StreamVByteMaxBytes(gaps.size()));
+    encoded.resize(EncodeStreamVByte(gaps.data(), gaps.size(), encoded.data()));
+
+    // Every truncation is caught, by either decoder, without reading past
+    // the end of the copy.
+    std::vector<uint32_t> decoded(gaps.size());
+    for (size_t size = 0; size < encoded.size(); ++size) {
+        std::vector<uint8_t> truncated(encoded.begin(), encoded.begin() + size);
+        const uint8_t* limit = truncated.data() + truncated.size();
+        EXPECT_EQ(DecodeStreamVByteDeltas(truncated.data(), limit, gaps.size(), 0, decoded.data()), nullptr)
+            << "size " << size;
+        EXPECT_EQ(DecodeStreamVByteDeltasScalar(truncated.data(), limit, gaps.size(), 0, decoded.data()), nullptr)
+            << "size " << size;
+    }
+}
+
+TEST(PostingCodecTest, SmallGapsTakeOneByteEach) {
+    std::vector<uint32_t> gaps(128, 3);
+    std::vector<uint8_t> encoded(StreamVByteMaxBytes(gaps.size()));
+
+    EXPECT_EQ(EncodeStreamVByte(gaps.data(), gaps.size(), encoded.data()), 32 + 128);
+}
+
+TEST(PostingCodecTest, BitPackRoundTrips) {
+    for (unsigned width : {0u, 1u, 3u, 7u, 8u, 13u, 31u, 32u}) {
+        std::vector<uint32_t> values;
+        for (uint32_t i = 0; i < 129; ++i) {
+            uint64_t limit = width == 32 ? 0xFFFFFFFFull : (1ull << width) - 1;
+            values.push_back(static_cast<uint32_t>((i * 2654435761ull) % (limit + 1)));
+        }
+
+        std::vector<uint8_t> packed(BitPackedBytes(values.size(), width));
+        EXPECT_EQ(BitPack(values.data(), values.size(), width, packed.data()), packed.size());
+
+        std::vector<uint32_t> unpacked(values.size());
+        BitUnpack(packed.data(), values.size(), width, unpacked.data());
+        EXPECT_EQ(unpacked, values) << "width " << width;
+    }
+}
+
+TEST(PostingCodecTest, BitWidthCountsSignificantBits) {
+    EXPECT_EQ(BitWidth(0), 0);
+    EXPECT_EQ(BitWidth(1), 1);
+    EXPECT_EQ(BitWidth(255), 8);
+    EXPECT_EQ(BitWidth(256), 9);
+    EXPECT_EQ(BitWidth(0xFFFFFFFFu), 32);
+}
@@ -0,0 +1,109 @@
+#include "PostingList.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+static std::vector<Posting> ToVector(const PostingList& list) {
+    return std::vector<Posting>(list.begin(), list.end());
+}
+
+TEST(PostingListTest, AtFindsFrequencyByDocId) {
+    PostingList list({{0, 2}, {3, 1}, {7, 5}});
+
+    EXPECT_EQ(list.size(), 3);
+    EXPECT_EQ(list.at(0), 2);
+    EXPECT_EQ(list.at(3), 1);
+    EXPECT_EQ(list.at(7), 5);
+    EXPECT_THROW(list.at(4), std::out_of_range);
+}
+
+TEST(PostingListTest, RoundTripsAcrossManyBlocks) {
+    std::vector<Posting> postings;
+    uint32_t doc_id = 0;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        doc_id += 1 + (i * 7919) % 300;
+        postings.push_back({doc_id, 1 + (i % 5 == 0 ? i : 0)});
+    }
+
+    PostingList list(postings);
+    EXPECT_EQ(list.size(), postings.size());
+    EXPECT_EQ(list.BlockCount(), (postings.size() + PostingList::kBlockSize - 1) / PostingList::kBlockSize);
+    EXPECT_EQ(ToVector(list), postings);
+    EXPECT_LT(list.ByteSize(), postings.size() * sizeof(Posting));
+
+    for (const Posting& posting : postings) {
+        EXPECT_EQ(list.at(posting.doc_id), posting.tf);
+    }
+
+    uint32_t max_tf = 0;
+    for (size_t block = 0; block < list.BlockCount(); ++block) {
+        size_t begin = block * PostingList::kBlockSize;
+        size_t end = std::min(postings.size(), begin + PostingList::kBlockSize);
+        uint32_t block_max = 0;
+        for (size_t i = begin; i < end; ++i) block_max = std::max(block_max, postings[i].tf);
+        EXPECT_EQ(list.BlockMaxTf(block), block_max);
+        max_tf = std::max(max_tf, block_max);
+    }
+    EXPECT_EQ(list.MaxTf(), max_tf);
+    EXPECT_EQ(PostingList().MaxTf(), 0u);
+    EXPECT_THROW(list.at(postings.back().doc_id + 1), std::out_of_range);
+}
+
+TEST(PostingListTest, AdvanceSkipsToTargetAcrossBlocks) {
+    std::vector<Posting> postings;
+    for (uint32_t i = 0; i < 1000; ++i) postings.push_back({3 * i + 1, i % 7 + 1});
+    PostingList list(postings);
+
+    EXPECT_EQ(list.FindBlock(0), 0u);
+    EXPECT_EQ(list.FindBlock(postings[128].doc_id), 1u);
+    EXPECT_EQ(list.FindBlock(postings[127].doc_id + 1), 1u);
+    EXPECT_EQ(list.FindBlock(postings[900].doc_id, 2), 900u / PostingList::kBlockSize);
+    EXPECT_EQ(list.FindBlock(postings.back().doc_id + 1), list.BlockCount());
+
+    auto it = list.begin();
+    for (uint32_t target : {0u, 1u, 2u, 5u, 380u, 384u, 385u, 1500u, 1500u, 2998u}) {
+        it.Advance(target);
+        auto expected = std::lower_bound(postings.begin(), postings.end(), target,
+            [](const Posting& posting, uint32_t doc_id) { return posting.doc_id < doc_id; });
+        ASSERT_NE(it, list.end());
+        EXPECT_EQ(*it, *expected) << target;
+        EXPECT_EQ(it.Index(), static_cast<size_t>(expected - postings.begin()));
+        EXPECT_EQ(it.Block(), it.Index() / PostingList::kBlockSize);
+    }
+
+    // Never moves back
+    it.Advance(10);
+    EXPECT_EQ(it->doc_id, 2998u);
+
+    it.Advance(postings.back().doc_id + 1);
+    EXPECT_EQ(it, list.end());
+    EXPECT_EQ(it->doc_id, PostingList::kEndDocId);
+    EXPECT_EQ(list.end()->doc_id, PostingList::kEndDocId);
+}
+
+TEST(PostingListTest, DecodedCopyReadsLikeTheOriginal) {
+    std::vector<Posting> postings;
+    for (uint32_t i = 0; i < 700; ++i) postings.push_back({5 * i + 2, i % 11 + 1});
+
+    PostingList decoded;
+    {
+        PostingList source(postings);
+        PostingList view = PostingList::View(source.Bytes(), source.ByteSize());
+        decoded = view.Decoded();
+        EXPECT_FALSE(view.IsDecoded());
+    }
+
+    // Owns everything it needs once the source is gone, and so do copies.
+    PostingList copy = decoded;
+    EXPECT_TRUE(copy.IsDecoded());
+    EXPECT_FALSE(copy.IsView());
+    EXPECT_EQ(copy, PostingList(postings));
+    EXPECT_EQ(copy.Decode(), postings);
+    EXPECT_EQ(copy.at(postings[555].doc_id), postings[555].tf);
+    EXPECT_GE(copy.MemoryBytes(), copy.ByteSize() + 2 * postings.size() * sizeof(uint32_t));
+
+    auto it = copy.begin();
+    it.Advance(postings[300].doc_id - 1);
+    EXPECT_EQ(*it, postings[300]);
+}
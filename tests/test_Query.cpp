@@ -0,0 +1,79 @@
+#include "Query.h"
+#include <gtest/gtest.h>
+
+static std::string Parsed(std::string_view request) {
+    return Query::Parse(request).ToString();
+}
+
+TEST(QueryTest, PlainWordsAreSortedAndUnique) {
+    Query query = Query::Parse("Banana apple, banana");
+
+    std::vector<std::string> words;
+    ASSERT_TRUE(query.PlainWords(words));
+    EXPECT_EQ(words, (std::vector<std::string>{"apple", "banana"}));
+    EXPECT_EQ(query.ToString(), "(apple OR banana)");
+    EXPECT_TRUE(Query::Parse(" ,. ").empty());
+}
+
+TEST(QueryTest, QuotesFormPhrases) {
+    Query query = Query::Parse("capital \"Moscow, Russia\" \"city\"");
+
+    std::vector<std::string> words;
+    EXPECT_FALSE(query.PlainWords(words));
+    EXPECT_EQ(query.ToString(), "(capital OR city OR \"moscow russia\")");
+
+    // Unterminated: the phrase runs to the end
+    EXPECT_EQ(Parsed("\"new york new"), "\"new york new\"");
+}
+
+TEST(QueryTest, NearBindsNeighbouringWords) {
+    EXPECT_EQ(Parsed("tea sugar NEAR/3 milk"), "(tea OR (milk NEAR/3 sugar))");
+    EXPECT_EQ(Parsed("a NEAR/2 b NEAR/5 c"), "(a NEAR/5 b NEAR/5 c)");
+}
+
+TEST(QueryTest, NearWithoutOperandsIsIgnored) {
+    EXPECT_EQ(Parsed("NEAR/3 milk"), "milk");
+    EXPECT_EQ(Parsed("milk NEAR/x tea"), "(milk OR near OR tea OR x)");
+    EXPECT_EQ(Parsed("near/3"), "(3 OR near)");
+    EXPECT_EQ(Parsed("\"black tea\" NEAR/2 milk"), "(milk OR \"black tea\")");
+    EXPECT_EQ(Parsed("milk NEAR/2 milk"), "milk");
+}
+
+TEST(QueryTest, AndBindsTighterThanOr) {
+    EXPECT_EQ(Parsed("a AND b c"), "(c OR (a AND b))");
+    EXPECT_EQ(Parsed("a OR b AND c"), "(a OR (b AND c))");
+    EXPECT_EQ(Parsed("(a OR b) AND c"), "(c AND (a OR b))");
+    EXPECT_EQ(Parsed("a AND (b AND c) AND a"), "(a AND b AND c)");
+    EXPECT_EQ(Parsed("((a))"), "a");
+
+    // Operators are case-sensitive
+    EXPECT_EQ(Parsed("a and b"), "(a OR and OR b)");
+}
+
+TEST(QueryTest, NotExcludesFromThePrecedingOperand) {
+    EXPECT_EQ(Parsed("a NOT b"), "(a NOT b)");
+    EXPECT_EQ(Parsed("a AND NOT b c"), "(c OR (a NOT b))");
+    EXPECT_EQ(Parsed("a NOT (b OR \"c d\")"), "(a NOT b NOT \"c d\")");
+    EXPECT_EQ(Parsed("a NOT NOT b"), "(a AND b)");
+
+    // Nothing to exclude from
+    EXPECT_TRUE(Query::Parse("NOT a").empty());
+    EXPECT_EQ(Parsed("NOT a b"), "b");
+}
+
+TEST(QueryTest, MalformedInputIsRepaired) {
+    EXPECT_EQ(Parsed("a AND"), "a");
+    EXPECT_EQ(Parsed("OR a AND AND b"), "(a AND b)");
+    EXPECT_EQ(Parsed("(a b"), "(a OR b)");
+    EXPECT_EQ(Parsed("a ) b"), "(a OR b)");
+    EXPECT_EQ(Parsed("() a"), "a");
+    EXPECT_TRUE(Query::Parse("( ) AND NOT").empty());
+}
+
+TEST(QueryTest, CanonicalFormParsesToTheSameTree) {
+    for (const char* request : {"tea \"green tea\" AND (milk NEAR/4 sugar) NOT lemon",
+                                "x OR (y AND z NOT w) OR \"a b c\""}) {
+        Query query = Query::Parse(request);
+        EXPECT_EQ(Query::Parse(query.ToString()).root, query.root) << request;
+    }
+}
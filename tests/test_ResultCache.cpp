@@ -0,0 +1,102 @@
+#include "ResultCache.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::vector<RelativeIndex> Results(size_t count) {
+    std::vector<RelativeIndex> results;
+    for (size_t i = 0; i < count; ++i) results.push_back({i, 1.0f / static_cast<float>(i + 1)});
+    return results;
+}
+
+TEST(ResultCacheTest, HitsOnlyForTheSameGeneration) {
+    ResultCache cache(1 << 20);
+    std::vector<RelativeIndex> results;
+
+    EXPECT_FALSE(cache.Get("apple", 1, results));
+    cache.Put("apple", 1, Results(3));
+
+    ASSERT_TRUE(cache.Get("apple", 1, results));
+    EXPECT_EQ(results, Results(3));
+
+    // A newer snapshot drops the entry instead of answering from it.
+    EXPECT_FALSE(cache.Get("apple", 2, results));
+    EXPECT_FALSE(cache.Get("apple", 1, results));
+
+    auto stats = cache.GetStats();
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 3);
+    EXPECT_EQ(stats.entries, 0);
+    EXPECT_EQ(stats.bytes, 0);
+}
+
+TEST(ResultCacheTest, LateResultsOfAnOlderGenerationAreIgnored) {
+    ResultCache cache(1 << 20);
+    std::vector<RelativeIndex> results;
+
+    cache.Put("apple", 2, Results(2));
+    cache.Put("apple", 1, Results(5));
+
+    ASSERT_TRUE(cache.Get("apple", 2, results));
+    EXPECT_EQ(results, Results(2));
+}
+
+TEST(ResultCacheTest, EvictsLeastRecentlyUsedWithinTheCap) {
+    // One shard, room for a few small entries
+    ResultCache cache(1000, 1);
+    std::vector<RelativeIndex> results;
+
+    for (int i = 0; i < 100; ++i) {
+        cache.Put("query" + std::to_string(i), 1, Results(2));
+        // Keeps the first query recently used
+        EXPECT_TRUE(cache.Get("query0", 1, results));
+        EXPECT_LE(cache.GetStats().bytes, 1000);
+    }
+
+    EXPECT_GT(cache.GetStats().entries, 1);
+    EXPECT_TRUE(cache.Get("query99", 1, results));
+    EXPECT_FALSE(cache.Get("query1", 1, results));
+
+    // Larger than the whole shard: not kept
+    cache.Put("large", 1, Results(1000));
+    EXPECT_FALSE(cache.Get("large", 1, results));
+    EXPECT_TRUE(cache.Get("query0", 1, results));
+}
+
+TEST(ResultCacheTest, DisabledCacheStoresNothing) {
+    ResultCache cache(0);
+    std::vector<RelativeIndex> results;
+
+    EXPECT_FALSE(cache.Enabled());
+    cache.Put("apple", 1, Results(1));
+    EXPECT_FALSE(cache.Get("apple", 1, results));
+    EXPECT_EQ(cache.GetStats().entries, 0);
+}
+
+TEST(ResultCacheTest, ConcurrentReadersAndWriters) {
+    ResultCache cache(64 * 1024, 4);
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&cache, t] {
+            std::vector<RelativeIndex> results;
+            for (int i = 0; i < 2000; ++i) {
+                std::string query = "query" + std::to_string(i % 50);
+                uint64_t generation = static_cast<uint64_t>(i / 500);
+                if (cache.Get(query, generation, results)) {
+                    EXPECT_EQ(results, Results(i % 50));
+                } else {
+                    cache.Put(query, generation, Results(i % 50));
+                }
+                if (t == 0 && i % 100 == 0) cache.GetStats();
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    auto stats = cache.GetStats();
+    EXPECT_EQ(stats.hits + stats.misses, 8000);
+    EXPECT_GT(stats.hits, 0);
+    EXPECT_LE(stats.bytes, 64 * 1024);
+}
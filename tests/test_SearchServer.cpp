@@ -2,8 +2,11 @@
 #include "InvertedIndex.h"
 #include "ConverterJSON.h"
 #include <gtest/gtest.h>
+#include <atomic>
 #include <filesystem>
 #include <fstream>
+#include <map>
+#include <thread>
 
 namespace fs = std::filesystem;
 
@@ -67,6 +70,33 @@ TEST_F(SearchServerTest, SearchReturnsCorrectResultsForMultiWordQuery) {
     EXPECT_FLOAT_EQ(results[0][2].rank, 1.0f/3);    // 1/3 ≈ 0.333...
 }
 
+TEST_F(SearchServerTest, SearchReturnsAtMostMaxResponses) {
+    SearchServer limited(_index, 2);
+    auto results = limited.search({"banana cherry", "banana"});
+
+    // Same order and ranks as without a limit, cut after two
+    EXPECT_EQ(results[0], (std::vector<RelativeIndex>{{2, 1.0f}, {1, 2.0f / 3}}));
+    // Ties go to the lower doc_id.
+    EXPECT_EQ(results[1], (std::vector<RelativeIndex>{{0, 1.0f}, {1, 1.0f}}));
+    EXPECT_EQ(SearchServer(_index, 1).search({"banana"})[0], (std::vector<RelativeIndex>{{0, 1.0f}}));
+}
+
+TEST(TopKTest, KeepsBestDocumentsWithTiesByDocId) {
+    TopK top(3);
+    for (RelativeIndex doc : std::vector<RelativeIndex>{{4, 1}, {9, 5}, {1, 2}, {7, 5}, {3, 2}, {0, 0.5f}}) {
+        top.Push(doc);
+    }
+    ASSERT_TRUE(top.Full());
+    EXPECT_EQ(top.Worst(), (RelativeIndex{1, 2}));
+    EXPECT_EQ(top.Take(), (std::vector<RelativeIndex>{{7, 5}, {9, 5}, {1, 2}}));
+
+    TopK unbounded(0);
+    unbounded.Push({2, 1});
+    unbounded.Push({1, 3});
+    EXPECT_FALSE(unbounded.Full());
+    EXPECT_EQ(unbounded.Take(), (std::vector<RelativeIndex>{{1, 3}, {2, 1}}));
+}
+
 TEST_F(SearchServerTest, SearchHandlesPunctuationInQueries) {
     auto results = server.search({"apple,", "banana! ?"});
 
@@ -103,3 +133,295 @@ TEST_F(SearchServerTest, SearchProcessesMultipleRequests) {
     EXPECT_EQ(results[1].size(), 2);    // banana
     EXPECT_EQ(results[2].size(), 2);    // cherry
 }
+
+TEST_F(SearchServerTest, SearchDoesNotReindex) {
+    std::ofstream("file1.txt", std::ios::app) << " durian";
+
+    auto stale_results = server.search({"durian"});
+    ASSERT_EQ(stale_results.size(), 1);
+    EXPECT_TRUE(stale_results[0].empty());
+    EXPECT_EQ(_index.Generation(), 1);
+
+    ASSERT_TRUE(_index.Refresh());
+    auto fresh_results = server.search({"durian"});
+    ASSERT_EQ(fresh_results[0].size(), 1);
+    EXPECT_EQ(fresh_results[0][0].doc_id, 0);
+}
+
+TEST_F(SearchServerTest, SearchBuildsIndexThatWasNeverBuilt) {
+    InvertedIndex fresh_index;
+    SearchServer fresh_server(fresh_index);
+
+    auto results = fresh_server.search({"apple"});
+    EXPECT_EQ(fresh_index.Generation(), 1);
+    ASSERT_EQ(results[0].size(), 1);
+    EXPECT_EQ(results[0][0].doc_id, 0);
+}
+
+TEST_F(SearchServerTest, QueriesAreCaseInsensitive) {
+    auto results = server.search({"APPLE", "Banana;Cherry"});
+
+    ASSERT_EQ(results.size(), 2);
+    ASSERT_EQ(results[0].size(), 1);
+    EXPECT_EQ(results[0][0].doc_id, 0);
+    EXPECT_EQ(results[1].size(), 3);
+}
+
+TEST_F(SearchServerTest, DeletedDocumentsDisappearFromResults) {
+    ASSERT_TRUE(_index.DeleteDocument(2));
+    EXPECT_FALSE(_index.DeleteDocument(2));
+
+    auto results = server.search({"cherry"});
+    ASSERT_EQ(results[0].size(), 1);
+    EXPECT_EQ(results[0][0].doc_id, 1);
+    EXPECT_FLOAT_EQ(results[0][0].rank, 1.0f);
+
+    // Unchanged on disk, so it stays deleted.
+    _index.UpdateDocumentBase();
+    EXPECT_EQ(server.search({"cherry"})[0].size(), 1);
+
+    _index.UpdateDocument(2, "file3.txt");
+    EXPECT_EQ(server.search({"cherry"})[0].size(), 2);
+}
+
+TEST_F(SearchServerTest, RepeatedQueriesAreAnsweredFromCacheUntilIndexChanges) {
+    SearchServer cached(_index, 0, 1 << 20);
+
+    auto first = cached.search({"cherry banana"});
+    EXPECT_EQ(cached.search({"Banana  cherry!"}), first);
+    EXPECT_EQ(cached.cacheStats().hits, 1);
+    EXPECT_EQ(cached.search({"cherry banana"})[0], first[0]);
+    EXPECT_EQ(cached.cacheStats().hits, 2);
+
+    _index.UpdateDocument(0, "file3.txt");
+    auto updated = cached.search({"cherry banana"})[0];
+    EXPECT_EQ(cached.cacheStats().hits, 2);
+    EXPECT_EQ(updated, server.search({"cherry banana"})[0]);
+    EXPECT_NE(updated, first[0]);
+}
+
+TEST_F(SearchServerTest, ParallelBatchKeepsRequestOrder) {
+    const char* requests[] = {"apple", "banana", "cherry", "banana cherry", "sugar", "", "apple OR cherry",
+                              "banana AND cherry", "cherry NOT apple"};
+    std::vector<std::string> batch;
+    for (int i = 0; i < 500; ++i) batch.push_back(requests[(i * 7) % 9]);
+
+    SearchServer parallel(_index, 2, 0, 4);
+    SearchServer sequential(_index, 2);
+    auto results = parallel.search(batch);
+    ASSERT_EQ(results.size(), batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        EXPECT_EQ(results[i], sequential.search({batch[i]})[0]) << batch[i];
+    }
+}
+
+TEST_F(SearchServerTest, ConcurrentSearchesSeeConsistentSnapshots) {
+    std::atomic<bool> done{false};
+    std::atomic<int> inconsistent{0};
+    std::atomic<int> searches{0};
+
+    // file1 flips between containing apple and not; file2 and file3 never
+    // mention it. Every answer must be one of the two complete states.
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            SearchServer reader(_index);
+            while (!done) {
+                auto results = reader.search({"apple banana"});
+                ++searches;
+                const auto& docs = results[0];
+                bool with_apple = docs.size() == 2 && docs[0].doc_id == 0 && docs[1].doc_id == 1;
+                bool without_apple = docs.size() == 1 && docs[0].doc_id == 1;
+                if (!with_apple && !without_apple) ++inconsistent;
+            }
+        });
+    }
+
+    for (int round = 0; round < 40; ++round) {
+        std::ofstream("file1.txt", std::ios::trunc) << (round % 2 ? "apple banana apple" : "kiwi");
+        fs::last_write_time("file1.txt", fs::file_time_type::clock::now() + std::chrono::seconds(round + 1));
+        _index.UpdateDocumentBase();
+    }
+    while (searches < 100) std::this_thread::yield();
+    done = true;
+    for (auto& reader : readers) reader.join();
+
+    EXPECT_EQ(inconsistent, 0);
+}
+
+TEST_F(SearchServerTest, PhraseAndNearQueriesUsePositions) {
+    // A tiny memory budget sends the initial build through spilled runs.
+    std::ofstream("config.json", std::ios::trunc) << R"({
+        "config": {"name":"Test","version":"1.0","max_responses":5,
+                   "index_positions":true,"index_memory_mb":0.000001},
+        "files": ["file1.txt", "file2.txt", "file3.txt"]
+    })";
+    InvertedIndex index;
+    SearchServer positional(index);
+
+    auto results = positional.search({
+        "\"banana cherry\"", "\"cherry banana\"", "\"cherry cherry\"",
+        "apple NEAR/1 banana", "cherry NEAR/1 apple", "\"banana cherry\" apple"
+    });
+    ASSERT_EQ(results.size(), 6);
+    EXPECT_EQ(results[0], (std::vector<RelativeIndex>{{1, 1.0f}}));
+    EXPECT_TRUE(results[1].empty());
+    EXPECT_EQ(results[2], (std::vector<RelativeIndex>{{2, 1.0f}}));
+    EXPECT_EQ(results[3], (std::vector<RelativeIndex>{{0, 1.0f}}));
+    EXPECT_TRUE(results[4].empty());
+    EXPECT_EQ(results[5], (std::vector<RelativeIndex>{{0, 1.0f}, {1, 0.5f}}));
+
+    // Positions survive updates, merges and a save and load.
+    std::ofstream("file1.txt", std::ios::trunc) << "cherry banana cherry";
+    index.UpdateDocument(0, "file1.txt");
+    EXPECT_EQ(positional.search({"\"banana cherry\""})[0],
+              (std::vector<RelativeIndex>{{0, 1.0f}, {1, 1.0f}}));
+
+    index.Save("positions.seg");
+    InvertedIndex loaded;
+    loaded.Load("positions.seg");
+    fs::remove("positions.seg");
+    EXPECT_EQ(SearchServer(loaded).search({"\"banana cherry\""})[0],
+              (std::vector<RelativeIndex>{{0, 1.0f}, {1, 1.0f}}));
+}
+
+TEST_F(SearchServerTest, PhraseWithoutPositionsMatchesAllWords) {
+    auto results = server.search({"\"cherry banana\""});
+
+    EXPECT_EQ(results[0], (std::vector<RelativeIndex>{{1, 1.0f}}));
+}
+
+TEST_F(SearchServerTest, BooleanOperatorsCombineDocuments) {
+    auto results = server.search({
+        "banana AND cherry", "banana NOT apple", "cherry NOT (apple OR banana)",
+        "(apple OR cherry) AND banana", "apple AND cherry", "NOT apple", "banana NOT \"banana cherry\""
+    });
+    ASSERT_EQ(results.size(), 7);
+    EXPECT_EQ(results[0], (std::vector<RelativeIndex>{{1, 1.0f}}));
+    EXPECT_EQ(results[1], (std::vector<RelativeIndex>{{1, 1.0f}}));
+    EXPECT_EQ(results[2], (std::vector<RelativeIndex>{{2, 1.0f}}));
+    // Ranks of all operands add up: apple x2 + banana, then cherry + banana
+    EXPECT_EQ(results[3], (std::vector<RelativeIndex>{{0, 1.0f}, {1, 2.0f / 3}}));
+    EXPECT_TRUE(results[4].empty());
+    EXPECT_TRUE(results[5].empty());
+    EXPECT_EQ(results[6], (std::vector<RelativeIndex>{{0, 1.0f}}));
+
+    // Limited searches of boolean queries are cut the same way.
+    EXPECT_EQ(SearchServer(_index, 1).search({"(apple OR cherry) AND banana"})[0],
+              (std::vector<RelativeIndex>{{0, 1.0f}}));
+}
+
+TEST(SearchServerBooleanTest, ConjunctionsMatchBruteForce) {
+    // Multi-block lists, so intersections skip and gallop across blocks
+    std::vector<std::string> files;
+    std::vector<std::map<std::string, int>> counts;
+    uint32_t seed = 777;
+    auto next = [&] { seed = seed * 1103515245u + 12345u; return (seed >> 8) % 1000; };
+    const char* words[] = {"common", "often", "sometimes", "rare"};
+    for (int doc = 0; doc < 700; ++doc) {
+        std::string text;
+        counts.emplace_back();
+        for (int i = 0; i < 30; ++i) {
+            uint32_t roll = next();
+            const char* word = roll < 600 ? words[0] : roll < 850 ? words[1] : roll < 990 ? words[2] : words[3];
+            text += word;
+            text += ' ';
+            ++counts.back()[word];
+        }
+        files.push_back("boolean" + std::to_string(doc) + ".txt");
+        std::ofstream(files.back()) << text;
+    }
+
+    std::ofstream config("config.json", std::ios::trunc);
+    config << R"({"config":{"name":"Test","version":"1.0","max_responses":5,"posting_cache_mb":4},"files":[)";
+    for (size_t i = 0; i < files.size(); ++i) config << (i ? "," : "") << '"' << files[i] << '"';
+    config << "]}";
+    config.close();
+
+    InvertedIndex index;
+    index.UpdateDocumentBase();
+    index.DeleteDocument(3);
+    counts[3].clear();
+
+    // Ranked like the server: summed counts of the required words
+    auto expect = [&](std::vector<const char*> required, std::vector<const char*> excluded) {
+        std::vector<RelativeIndex> docs;
+        for (size_t doc = 0; doc < counts.size(); ++doc) {
+            float rank = 0;
+            bool match = true;
+            for (const auto& word : required) {
+                match = match && counts[doc].count(word) > 0;
+                if (match) rank += static_cast<float>(counts[doc][word]);
+            }
+            for (const auto& word : excluded) match = match && counts[doc].count(word) == 0;
+            if (match) docs.push_back({doc, rank});
+        }
+        std::stable_sort(docs.begin(), docs.end(),
+            [](const RelativeIndex& a, const RelativeIndex& b) { return a.rank > b.rank; });
+        float max_rank = docs.front().rank;
+        for (auto& doc : docs) doc.rank /= max_rank;
+        return docs;
+    };
+
+    // Later passes read the lists decoded from the posting cache.
+    for (int pass = 0; pass < 3; ++pass) {
+        auto results = SearchServer(index).search({
+            "common AND rare", "rare AND sometimes AND often", "common NOT rare", "often AND sometimes NOT rare"
+        });
+        EXPECT_EQ(results[0], expect({"common", "rare"}, {}));
+        EXPECT_EQ(results[1], expect({"rare", "sometimes", "often"}, {}));
+        EXPECT_EQ(results[2], expect({"common"}, {"rare"}));
+        EXPECT_EQ(results[3], expect({"often", "sometimes"}, {"rare"}));
+    }
+    EXPECT_GT(index.PostingCacheStats().hits, 0);
+
+    for (const auto& file : files) fs::remove(file);
+    fs::remove("config.json");
+}
+
+TEST(SearchServerPruningTest, TopKMatchesExhaustiveRanking) {
+    // Skewed term frequencies over enough documents for multi-block lists
+    std::vector<std::string> files;
+    uint32_t seed = 12345;
+    auto next = [&] { seed = seed * 1103515245u + 12345u; return (seed >> 8) % 1000; };
+    const char* words[] = {"common", "often", "sometimes", "rare", "never"};
+    for (int doc = 0; doc < 600; ++doc) {
+        std::string text;
+        for (int i = 0; i < 40; ++i) {
+            uint32_t roll = next();
+            text += roll < 500 ? words[0] : roll < 800 ? words[1] : roll < 950 ? words[2] : words[3];
+            text += ' ';
+        }
+        files.push_back("pruning" + std::to_string(doc) + ".txt");
+        std::ofstream(files.back()) << text;
+    }
+
+    std::ofstream config("config.json", std::ios::trunc);
+    config << R"({"config":{"name":"Test","version":"1.0","max_responses":5},"files":[)";
+    for (size_t i = 0; i < files.size(); ++i) config << (i ? "," : "") << '"' << files[i] << '"';
+    config << "]}";
+    config.close();
+
+    InvertedIndex index;
+    index.UpdateDocumentBase();
+    index.DeleteDocument(7);
+
+    std::vector<std::string> requests = {"common", "rare", "common rare", "often sometimes rare",
+                                         "common often sometimes rare never", "never"};
+    auto exhaustive = SearchServer(index).search(requests);
+    for (size_t k : {1, 5, 50}) {
+        auto pruned = SearchServer(index, k).search(requests);
+        // Lone requests split by doc_id over four threads
+        SearchServer partitioned(index, k, 0, 4);
+        partitioned.setPartitionPostings(1);
+        for (size_t i = 0; i < requests.size(); ++i) {
+            std::vector<RelativeIndex> expected(
+                exhaustive[i].begin(), exhaustive[i].begin() + std::min(k, exhaustive[i].size()));
+            EXPECT_EQ(pruned[i], expected) << requests[i] << " k=" << k;
+            EXPECT_EQ(partitioned.search({requests[i]})[0], expected) << requests[i] << " k=" << k;
+        }
+    }
+
+    for (const auto& file : files) fs::remove(file);
+    fs::remove("config.json");
+}
@@ -0,0 +1,335 @@
+#include "Segment.h"
+#include "InvertedIndex.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace fs = std::filesystem;
+
+class SegmentTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        writeFile("segment_doc1.txt", "alpha beta beta");
+        writeFile("segment_doc2.txt", "beta gamma");
+
+        std::ofstream config("config.json");
+        config << R"({
+            "config": {
+                "name": "TestSearchEngine",
+                "version": "1.0",
+                "max_responses": 5
+            },
+            "files": [
+                "segment_doc1.txt",
+                "segment_doc2.txt"
+            ]
+        })";
+    }
+
+    void TearDown() override {
+        for (const char* file : {"segment_doc1.txt", "segment_doc2.txt", "config.json", "test.seg"}) {
+            if (fs::exists(file)) fs::remove(file);
+        }
+    }
+
+    static void writeFile(const std::string& path, const std::string& content) {
+        std::ofstream file(path, std::ios::binary);
+        file << content;
+    }
+
+    static std::vector<Posting> decode(const PostingList& postings) {
+        return {postings.begin(), postings.end()};
+    }
+};
+
+TEST_F(SegmentTest, RoundTripsTermsPostingsAndDocuments) {
+    SegmentWriter writer("test.seg");
+    writer.AddTerm("apple", PostingList({{0, 2}, {5, 1}}));
+    writer.AddTerm("banana", PostingList({{5, 7}}));
+    writer.AddDocument(0, true, "a.txt", 10, 123, 0xabcdef);
+    writer.AddDocument(3, false, "missing.txt", 0, 0, 0);
+    writer.Finish();
+
+    auto segment = Segment::Open("test.seg", true);
+    ASSERT_EQ(segment->TermCount(), 2u);
+    EXPECT_EQ(segment->Term(0), "apple");
+    EXPECT_EQ(segment->FindTerm("banana"), 1u);
+    EXPECT_EQ(segment->FindTerm("cherry"), Segment::kNoTerm);
+
+    PostingList postings = segment->Postings(0);
+    EXPECT_TRUE(postings.IsView());
+    EXPECT_EQ(decode(postings), (std::vector<Posting>{{0, 2}, {5, 1}}));
+
+    ASSERT_EQ(segment->DocumentCount(), 2u);
+    Segment::DocumentEntry document = segment->Document(0);
+    EXPECT_EQ(document.path, "a.txt");
+    EXPECT_TRUE(document.exists);
+    EXPECT_EQ(document.size, 10u);
+    EXPECT_EQ(document.mtime, 123);
+    EXPECT_EQ(document.content_hash, 0xabcdefu);
+    EXPECT_FALSE(segment->Document(1).exists);
+    EXPECT_TRUE(segment->ContainsDocument(3));
+    EXPECT_FALSE(segment->ContainsDocument(1));
+}
+
+TEST_F(SegmentTest, InMemorySegmentMatchesFileSegment) {
+    SegmentWriter writer;
+    writer.AddTerm("apple", PostingList({{0, 2}, {5, 1}}));
+    writer.AddDocument(0, true, "a.txt", 10, 123, 1);
+    writer.AddDocument(5, true, "b.txt", 20, 456, 2);
+    auto segment = writer.Finish();
+
+    EXPECT_TRUE(segment->VerifyChecksum());
+    EXPECT_EQ(segment->FindTerm("apple"), 0u);
+    EXPECT_EQ(decode(segment->Postings(0)), (std::vector<Posting>{{0, 2}, {5, 1}}));
+    EXPECT_EQ(segment->Document(1).path, "b.txt");
+}
+
+TEST_F(SegmentTest, StreamedTermsMatchEncodedTerms) {
+    // Large enough to overflow the writer's buffer into its scratch file
+    std::vector<Posting> postings;
+    std::vector<uint32_t> positions;
+    for (uint32_t doc_id = 0; doc_id < 600000; ++doc_id) {
+        uint32_t tf = 1 + doc_id % 3;
+        postings.push_back({doc_id * 300, tf});
+        for (uint32_t j = 0; j < tf; ++j) positions.push_back(doc_id % 1000 + j * 7);
+    }
+
+    SegmentWriter writer("test.seg", true);
+    writer.BeginTerm("apple");
+    writer.EndTerm();
+    writer.BeginTerm("banana");
+    const uint32_t* position = positions.data();
+    for (const Posting& posting : postings) {
+        writer.AddPosting(posting, position);
+        position += posting.tf;
+    }
+    size_t bytes = writer.EndTerm();
+    writer.AddTerm("cherry", PostingList({{1, 1}}), PositionList({{1, 1}}, {4}));
+    EXPECT_THROW(writer.AddPosting({2, 1}), std::logic_error);
+    writer.Finish();
+    EXPECT_FALSE(fs::exists("test.seg.tmp.postings"));
+
+    auto segment = Segment::Open("test.seg", true);
+    PostingList expected(postings);
+    PositionList expected_positions(postings, positions);
+    EXPECT_GT(expected.ByteSize(), SegmentWriter::kTermBufferBytes);
+    EXPECT_EQ(bytes, expected.ByteSize() + expected_positions.ByteSize());
+
+    // A term without postings is left out.
+    ASSERT_EQ(segment->TermCount(), 2u);
+    EXPECT_EQ(segment->FindTerm("apple"), Segment::kNoTerm);
+    ASSERT_EQ(segment->FindTerm("banana"), 0u);
+    EXPECT_EQ(segment->Postings(0), expected);
+    PositionList stored = segment->Positions(0);
+    ASSERT_EQ(stored.ByteSize(), expected_positions.ByteSize());
+    EXPECT_EQ(std::memcmp(stored.Bytes(), expected_positions.Bytes(), stored.ByteSize()), 0);
+    EXPECT_EQ(decode(segment->Postings(1)), (std::vector<Posting>{{1, 1}}));
+}
+
+TEST_F(SegmentTest, TermFilterRulesOutAbsentTerms) {
+    SegmentWriter writer("test.seg");
+    for (int i = 0; i < 1000; ++i) {
+        char term[16];
+        std::snprintf(term, sizeof(term), "term%04d", i);
+        writer.AddTerm(term, PostingList({{static_cast<uint32_t>(i), 1}}));
+    }
+    writer.Finish();
+
+    auto segment = Segment::Open("test.seg", true);
+    EXPECT_TRUE(segment->MayContainTerm("term0042"));
+    EXPECT_EQ(segment->FindTerm("term0042"), 42u);
+
+    size_t passed = 0;
+    for (int i = 0; i < 1000; ++i) {
+        std::string absent = "sugar" + std::to_string(i);
+        if (segment->MayContainTerm(absent)) ++passed;
+        EXPECT_EQ(segment->FindTerm(absent), Segment::kNoTerm);
+    }
+    EXPECT_LT(passed, 50u);
+}
+
+TEST_F(SegmentTest, RejectsDocumentsOutOfOrder) {
+    SegmentWriter writer;
+    writer.AddDocument(2, true, "a.txt", 0, 0, 0);
+    EXPECT_THROW(writer.AddDocument(1, true, "b.txt", 0, 0, 0), std::logic_error);
+}
+
+TEST_F(SegmentTest, RejectsTermsOutOfOrder) {
+    SegmentWriter writer("test.seg");
+    writer.AddTerm("beta", PostingList({{0, 1}}));
+    EXPECT_THROW(writer.AddTerm("alpha", PostingList({{0, 1}})), std::logic_error);
+}
+
+TEST_F(SegmentTest, DetectsCorruption) {
+    SegmentWriter writer("test.seg");
+    writer.AddTerm("apple", PostingList({{0, 2}, {5, 1}}));
+    writer.Finish();
+
+    {
+        std::fstream file("test.seg", std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-1, std::ios::end);
+        file.put('\x7f');
+    }
+    EXPECT_NO_THROW(Segment::Open("test.seg"));
+    EXPECT_THROW(Segment::Open("test.seg", true), std::runtime_error);
+
+    fs::resize_file("test.seg", fs::file_size("test.seg") - 1);
+    EXPECT_THROW(Segment::Open("test.seg"), std::runtime_error);
+
+    writeFile("test.seg", "not a segment");
+    EXPECT_THROW(Segment::Open("test.seg"), std::runtime_error);
+    EXPECT_THROW(Segment::Open("no_such.seg"), std::runtime_error);
+}
+
+TEST_F(SegmentTest, LoadedIndexMatchesSavedIndex) {
+    InvertedIndex built;
+    built.UpdateDocumentBase();
+    built.Save("test.seg");
+
+    InvertedIndex loaded;
+    loaded.Load("test.seg");
+    EXPECT_GT(loaded.Generation(), 0u);
+
+    for (const char* word : {"alpha", "beta", "gamma"}) {
+        EXPECT_EQ(decode(loaded.GetWordCount(word)), decode(built.GetWordCount(word))) << word;
+    }
+    EXPECT_TRUE(loaded.GetWordCount("delta").empty());
+    EXPECT_FALSE(loaded.IsStale());
+}
+
+TEST_F(SegmentTest, LoadSurvivesAnyCorruptByte) {
+    InvertedIndex built;
+    built.UpdateDocumentBase();
+    built.Save("test.seg");
+
+    std::ifstream in("test.seg", std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+
+    for (size_t at = 0; at < bytes.size(); ++at) {
+        std::string corrupt = bytes;
+        corrupt[at] ^= 0x40;
+        writeFile("test.seg", corrupt);
+
+        InvertedIndex verified;
+        EXPECT_THROW(verified.Load("test.seg", true), std::runtime_error) << "byte " << at;
+
+        // Unverified, lookups either fail or stay inside the file.
+        InvertedIndex loaded;
+        try {
+            loaded.Load("test.seg");
+            for (const char* word : {"alpha", "beta", "gamma"}) loaded.GetWordCount(word);
+        } catch (const std::runtime_error&) {
+        }
+    }
+}
+
+TEST_F(SegmentTest, CorruptListsAreDecodedWithinBounds) {
+    // Two blocks of postings, with positions
+    std::vector<Posting> postings;
+    std::vector<uint32_t> positions;
+    for (uint32_t i = 0; i < 200; ++i) {
+        postings.push_back({i * 3, 2});
+        positions.push_back(i);
+        positions.push_back(i + 1000);
+    }
+    SegmentWriter writer("test.seg", true);
+    writer.AddTerm("alpha", PostingList(postings), PositionList(postings, positions));
+    writer.AddTerm("beta", PostingList({{1, 1}}), PositionList({{1, 1}}, {7}));
+    writer.AddDocument(0, true, "segment_doc1.txt", 0, 0, 0);
+    writer.Finish();
+
+    std::ifstream in("test.seg", std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+
+    for (size_t at = 0; at < bytes.size(); ++at) {
+        std::string corrupt = bytes;
+        corrupt[at] ^= 0x40;
+        writeFile("test.seg", corrupt);
+
+        EXPECT_THROW(Segment::Open("test.seg", true), std::runtime_error) << "byte " << at;
+        std::shared_ptr<const Segment> segment;
+        try {
+            segment = Segment::Open("test.seg");
+        } catch (const std::runtime_error&) {
+            continue;
+        }
+        for (uint32_t term_id = 0; term_id < segment->TermCount(); ++term_id) {
+            try {
+                segment->FindTerm(segment->Term(term_id));
+                PostingList list = segment->Postings(term_id);
+                PositionList list_positions = segment->Positions(term_id);
+                std::vector<uint32_t> out;
+                for (auto it = list.begin(); it != list.end(); ++it) {
+                    list_positions.Decode(it.Index(), it->tf, out);
+                }
+                list.begin().Advance(400);
+            } catch (const std::runtime_error&) {
+            }
+        }
+        for (size_t i = 0; i < segment->DocumentCount(); ++i) segment->Document(i);
+    }
+}
+
+TEST_F(SegmentTest, LoadedIndexUpdatesIncrementally) {
+    InvertedIndex built;
+    built.UpdateDocumentBase();
+    built.Save("test.seg");
+
+    InvertedIndex loaded;
+    loaded.Load("test.seg");
+    uint64_t generation = loaded.Generation();
+
+    writeFile("segment_doc2.txt", "gamma delta");
+    fs::last_write_time("segment_doc2.txt", fs::last_write_time("segment_doc2.txt") + std::chrono::seconds(2));
+
+    loaded.UpdateDocumentBase();
+    EXPECT_GT(loaded.Generation(), generation);
+    EXPECT_EQ(decode(loaded.GetWordCount("beta")), (std::vector<Posting>{{0, 2}}));
+    EXPECT_EQ(decode(loaded.GetWordCount("delta")), (std::vector<Posting>{{1, 1}}));
+    EXPECT_EQ(decode(loaded.GetWordCount("alpha")), (std::vector<Posting>{{0, 1}}));
+}
+
+TEST_F(SegmentTest, LoadedIndexKeepsDeletedDocuments) {
+    InvertedIndex built;
+    built.UpdateDocumentBase();
+    ASSERT_TRUE(built.DeleteDocument(1));
+    built.Save("test.seg");
+
+    auto segment = Segment::Open("test.seg");
+    ASSERT_EQ(segment->DocumentCount(), 2u);
+    EXPECT_FALSE(segment->Document(0).deleted);
+    EXPECT_TRUE(segment->Document(1).deleted);
+    EXPECT_TRUE(segment->Document(1).exists);
+    segment.reset();
+
+    InvertedIndex loaded;
+    loaded.Load("test.seg");
+    EXPECT_TRUE(loaded.GetWordCount("gamma").empty());
+    // Nothing live is left to delete, so nothing changes.
+    uint64_t generation = loaded.Generation();
+    EXPECT_FALSE(loaded.DeleteDocument(1));
+    EXPECT_EQ(loaded.Generation(), generation);
+    EXPECT_EQ(loaded.GetSnapshot()->segments.front().deleted_count, 1u);
+
+    // Unchanged, the document stays deleted; a new save still says so.
+    EXPECT_FALSE(loaded.IsStale());
+    loaded.UpdateDocumentBase();
+    EXPECT_TRUE(loaded.GetWordCount("gamma").empty());
+    loaded.Save("test.seg");
+    EXPECT_TRUE(Segment::Open("test.seg")->Document(1).deleted);
+
+    writeFile("segment_doc2.txt", "gamma delta");
+    fs::last_write_time("segment_doc2.txt", fs::last_write_time("segment_doc2.txt") + std::chrono::seconds(2));
+
+    loaded.UpdateDocumentBase();
+    EXPECT_EQ(decode(loaded.GetWordCount("gamma")), (std::vector<Posting>{{1, 1}}));
+    EXPECT_EQ(decode(loaded.GetWordCount("beta")), (std::vector<Posting>{{0, 2}}));
+    loaded.Save("test.seg");
+    EXPECT_FALSE(Segment::Open("test.seg")->Document(1).deleted);
+}
@@ -0,0 +1,49 @@
+#include "TermFilter.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+static std::vector<uint64_t> Hashes(const std::string& prefix, size_t count) {
+    std::vector<uint64_t> hashes;
+    for (size_t i = 0; i < count; ++i) hashes.push_back(TermFilter::Hash(prefix + std::to_string(i)));
+    return hashes;
+}
+
+TEST(TermFilterTest, ContainsEveryAddedTerm) {
+    for (size_t count : {0, 1, 50, 10000}) {
+        TermFilter filter(Hashes("term", count));
+        EXPECT_EQ(filter.ByteSize() % TermFilter::kBlockBytes, 0u);
+        EXPECT_GE(filter.ByteSize() * 8, count * TermFilter::kBitsPerTerm);
+        for (size_t i = 0; i < count; ++i) {
+            ASSERT_TRUE(filter.MayContain("term" + std::to_string(i))) << count << " " << i;
+        }
+    }
+}
+
+TEST(TermFilterTest, RejectsMostAbsentTerms) {
+    TermFilter filter(Hashes("present", 20000));
+
+    size_t passed = 0;
+    for (size_t i = 0; i < 100000; ++i) {
+        if (filter.MayContain("absent" + std::to_string(i))) ++passed;
+    }
+    // About 1% expected
+    EXPECT_LT(passed, 2500u);
+
+    TermFilter empty_terms(std::vector<uint64_t>{});
+    EXPECT_FALSE(empty_terms.MayContain("anything"));
+}
+
+TEST(TermFilterTest, ViewAnswersLikeTheFilter) {
+    TermFilter filter(Hashes("word", 300));
+    TermFilter view = TermFilter::View(filter.Bytes(), filter.ByteSize());
+
+    for (size_t i = 0; i < 1000; ++i) {
+        std::string term = (i % 2 ? "word" : "other") + std::to_string(i);
+        EXPECT_EQ(view.MayContain(term), filter.MayContain(term));
+    }
+
+    // Without bytes nothing can be ruled out
+    EXPECT_TRUE(TermFilter().MayContain("anything"));
+    EXPECT_TRUE(TermFilter::View(nullptr, 0).MayContain("anything"));
+}
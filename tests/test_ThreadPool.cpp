@@ -0,0 +1,107 @@
+#include "ThreadPool.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(ThreadPoolTest, DefaultSizeIsAtLeastOne) {
+    ThreadPool pool;
+    EXPECT_GE(pool.Size(), 1);
+}
+
+TEST(ThreadPoolTest, UsesRequestedThreadCount) {
+    ThreadPool pool(3);
+    EXPECT_EQ(pool.Size(), 3);
+}
+
+TEST(ThreadPoolTest, RunsAllSubmittedTasks) {
+    ThreadPool pool(4);
+    std::atomic<int> counter{0};
+
+    for (int i = 0; i < 1000; ++i) {
+        pool.Submit([&counter] { counter++; });
+    }
+    pool.Wait();
+
+    EXPECT_EQ(counter.load(), 1000);
+}
+
+TEST(ThreadPoolTest, ParallelForCoversWholeRangeOnce) {
+    ThreadPool pool(4);
+    std::vector<int> hits(1001, 0);
+
+    pool.ParallelFor(hits.size(), 7, [&hits](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) hits[i]++;
+    });
+
+    for (size_t i = 0; i < hits.size(); ++i) {
+        EXPECT_EQ(hits[i], 1) << "index " << i;
+    }
+}
+
+TEST(ThreadPoolTest, PoolIsReusableAfterWait) {
+    ThreadPool pool(2);
+    std::atomic<int> counter{0};
+
+    for (int round = 0; round < 3; ++round) {
+        pool.ParallelFor(10, 0, [&counter](size_t begin, size_t end) {
+            counter += static_cast<int>(end - begin);
+        });
+    }
+
+    EXPECT_EQ(counter.load(), 30);
+}
+
+TEST(ThreadPoolTest, WaitRethrowsTaskException) {
+    ThreadPool pool(2);
+    pool.Submit([] { throw std::runtime_error("task failed"); });
+
+    EXPECT_THROW(pool.Wait(), std::runtime_error);
+    EXPECT_NO_THROW(pool.Wait());
+}
+
+TEST(ThreadPoolTest, ForEachRunsEveryIndexOnce) {
+    ThreadPool pool(4);
+    std::vector<std::atomic<int>> hits(5000);
+
+    pool.ForEach(hits.size(), [&hits](size_t i) { hits[i]++; });
+
+    for (size_t i = 0; i < hits.size(); ++i) {
+        EXPECT_EQ(hits[i].load(), 1) << "index " << i;
+    }
+    EXPECT_NO_THROW(pool.ForEach(0, [](size_t) { FAIL(); }));
+}
+
+TEST(ThreadPoolTest, ForEachCallersShareThePool) {
+    ThreadPool pool(2);
+    // Keeps a worker busy: ForEach must not wait for it
+    std::atomic<bool> release{false};
+    pool.Submit([&release] { while (!release) std::this_thread::yield(); });
+
+    std::vector<std::thread> callers;
+    std::atomic<int> counter{0};
+    for (int c = 0; c < 3; ++c) {
+        callers.emplace_back([&] {
+            for (int round = 0; round < 20; ++round) {
+                pool.ForEach(50, [&counter](size_t) { counter++; });
+            }
+        });
+    }
+    for (auto& caller : callers) caller.join();
+    EXPECT_EQ(counter.load(), 3 * 20 * 50);
+
+    release = true;
+    pool.Wait();
+}
+
+TEST(ThreadPoolTest, ForEachRethrowsBodyException) {
+    ThreadPool pool(3);
+    EXPECT_THROW(pool.ForEach(100, [](size_t i) {
+        if (i == 42) throw std::runtime_error("item failed");
+    }), std::runtime_error);
+
+    std::atomic<int> counter{0};
+    pool.ForEach(10, [&counter](size_t) { counter++; });
+    EXPECT_EQ(counter.load(), 10);
+}
@@ -0,0 +1,130 @@
+#include "MappedFile.h"
+#include "Tokenizer.h"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static std::vector<std::string> Tokenize(std::string_view text) {
+    std::vector<std::string> tokens;
+    Tokenizer tokenizer(text);
+    std::string_view token;
+    while (tokenizer.Next(token)) tokens.emplace_back(token);
+    return tokens;
+}
+
+TEST(TokenizerTest, SplitsOnWhitespace) {
+    auto tokens = Tokenize("  hello\tworld\n\nof \r\v\fwarcraft ");
+    std::vector<std::string> expected = {"hello", "world", "of", "warcraft"};
+    EXPECT_EQ(tokens, expected);
+}
+
+TEST(TokenizerTest, HandlesEmptyAndBlankText) {
+    EXPECT_TRUE(Tokenize("").empty());
+    EXPECT_TRUE(Tokenize(" \n\t ").empty());
+}
+
+TEST(TokenizerTest, SplitsOnPunctuationAndFoldsCase) {
+    auto tokens = Tokenize("Hello, World! \"Quoted\" e-mail (x2) 42nd");
+    std::vector<std::string> expected = {"hello", "world", "quoted", "e", "mail", "x2", "42nd"};
+    EXPECT_EQ(tokens, expected);
+}
+
+TEST(TokenizerTest, KeepsNonAsciiBytesInsideWords) {
+    // "Москва, Russia" in UTF-8: only ASCII letters are folded.
+    auto tokens = Tokenize("\xd0\x9c\xd0\xbe\xd1\x81\xd0\xba\xd0\xb2\xd0\xb0, Russia");
+    std::vector<std::string> expected = {
+        "\xd0\x9c\xd0\xbe\xd1\x81\xd0\xba\xd0\xb2\xd0\xb0", "russia"};
+    EXPECT_EQ(tokens, expected);
+}
+
+TEST(TokenizerTest, AllKernelsAgree) {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    // Lengths around the 16/32/64 byte block sizes exercise the scalar tail.
+    for (size_t length : {0, 1, 15, 16, 17, 31, 33, 63, 64, 65, 127, 200, 4099}) {
+        std::string text(length, '\0');
+        for (auto& c : text) c = static_cast<char>(byte(rng));
+
+        auto collect = [&text](TextKernelIsa isa) {
+            std::vector<std::string> tokens;
+            Tokenizer tokenizer(text, isa);
+            std::string_view token;
+            while (tokenizer.Next(token)) tokens.emplace_back(token);
+            return tokens;
+        };
+
+        auto expected = collect(TextKernelIsa::Scalar);
+        EXPECT_EQ(collect(TextKernelIsa::SSE2), expected) << "length " << length;
+        EXPECT_EQ(collect(TextKernelIsa::AVX2), expected) << "length " << length;
+    }
+}
+
+TEST(TokenizerTest, ClassifyAndFoldMarksWordBytes) {
+    std::string text = "Ab,\x80 9";
+    std::string folded(text.size(), '\0');
+    uint64_t mask = ~0ull;
+
+    ClassifyAndFold(text.data(), text.size(), folded.data(), &mask);
+
+    EXPECT_EQ(folded, "ab,\x80 9");
+    EXPECT_EQ(mask, 0b101011ull);
+}
+
+TEST(MappedFileTest, MapsRegularFile) {
+    std::ofstream("mapped_file_test.txt") << "hello mapped world";
+
+    MappedFile file("mapped_file_test.txt");
+    ASSERT_TRUE(file.IsOpen());
+    EXPECT_TRUE(file.IsMapped());
+    EXPECT_EQ(file.Data(), "hello mapped world");
+
+    fs::remove("mapped_file_test.txt");
+}
+
+TEST(MappedFileTest, EmptyFileIsOpenWithNoData) {
+    { std::ofstream file("mapped_empty_test.txt"); }
+
+    MappedFile file("mapped_empty_test.txt");
+    EXPECT_TRUE(file.IsOpen());
+    EXPECT_TRUE(file.Data().empty());
+
+    fs::remove("mapped_empty_test.txt");
+}
+
+TEST(MappedFileTest, MissingFileIsNotOpen) {
+    MappedFile file("no_such_file_for_mapping.txt");
+    EXPECT_FALSE(file.IsOpen());
+    EXPECT_TRUE(file.Data().empty());
+}
+
+#ifndef _WIN32
+TEST(MappedFileTest, ReadsPipeThroughBuffer) {
+    const std::string fifo = "mapped_fifo_test";
+    fs::remove(fifo);
+    ASSERT_EQ(mkfifo(fifo.c_str(), 0600), 0);
+
+    std::string payload(200 * 1024, 'x');
+    payload += " tail";
+    std::thread writer([&] { std::ofstream(fifo) << payload; });
+
+    MappedFile file(fifo);
+    writer.join();
+
+    ASSERT_TRUE(file.IsOpen());
+    EXPECT_FALSE(file.IsMapped());
+    EXPECT_EQ(file.Data(), payload);
+
+    fs::remove(fifo);
+}
+#endif